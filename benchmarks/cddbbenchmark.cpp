@@ -0,0 +1,228 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "cddbbenchmark.h"
+#include "libkcddb/cddb.h"
+#include "libkcddb/cdinfo.h"
+#include "libkcddb/discid.h"
+
+#include <QTest>
+#include <QVector>
+
+using namespace KCDDB;
+
+namespace
+{
+  // Repeats @p sample until the text is @p length characters long
+  QString fill(const QString &sample, int length)
+  {
+    QString text;
+    while (text.length() < length)
+      text += sample;
+    text.truncate(length);
+    return text;
+  }
+
+  // Writes KEY=value the way servers do, with long values continued over
+  // several lines of the same key
+  void addLines(QString &entry, const QString &key, const QString &value)
+  {
+    const int lineLength = 70;
+    int pos = 0;
+    do
+    {
+      entry += key + QLatin1Char('=') + value.mid(pos, lineLength) + QLatin1Char('\n');
+      pos += lineLength;
+    } while (pos < value.length());
+  }
+
+  QString makeEntry(int tracks, const QString &sample, int titleLength, int commentLength)
+  {
+    QString entry = QString::fromUtf8("# xmcd\n#\n# Track frame offsets:\n");
+    for (int i = 0; i < tracks; ++i)
+      entry += QString::fromUtf8("#\t%1\n").arg(150 + i * 15000);
+    entry += QString::fromUtf8("#\n# Disc length: %1 seconds\n#\n").arg((150 + tracks * 15000) / 75);
+    entry += QString::fromUtf8("# Revision: 3\n# Submitted via: libkcddb 0.5\n#\n");
+
+    entry += QString::fromUtf8("DISCID=a1107d0a\n");
+    addLines(entry, QString::fromUtf8("DTITLE"), fill(sample, 30) + QString::fromUtf8(" / ") + fill(sample, 40));
+    entry += QString::fromUtf8("DYEAR=1998\nDGENRE=Classical\n");
+
+    for (int i = 0; i < tracks; ++i)
+      addLines(entry, QString::fromUtf8("TTITLE%1").arg(i), fill(sample, titleLength));
+
+    // Comments are full of escaped line breaks
+    QString comment = fill(sample + QString::fromUtf8("\\n"), commentLength);
+    addLines(entry, QString::fromUtf8("EXTD"), comment);
+
+    for (int i = 0; i < tracks; ++i)
+      addLines(entry, QString::fromUtf8("EXTT%1").arg(i), i % 3 ? QString() : fill(sample, commentLength / 20));
+
+    entry += QString::fromUtf8("PLAYORDER=\n");
+
+    return entry;
+  }
+
+  TrackOffsetList makeToc(int tracks)
+  {
+    TrackOffsetList toc;
+    for (int i = 0; i <= tracks; ++i)
+      toc << 150 + i * 15011;
+    return toc;
+  }
+}
+
+void CDDBBenchmark::initTestCase()
+{
+  const QString english = QString::fromUtf8("Symphony No. 9 in D minor, Op. 125 ");
+  const QString german = QString::fromUtf8("Größe Fuge für Streichquartett ");
+  const QString japanese = QString::fromUtf8("交響曲第9番ニ短調作品125「合唱付き」");
+
+  m_entries << qMakePair(QByteArray("12 tracks"), makeEntry(12, english, 40, 200).toUtf8());
+  m_entries << qMakePair(QByteArray("99 tracks"), makeEntry(99, english, 40, 200).toUtf8());
+  m_entries << qMakePair(QByteArray("long EXTD"), makeEntry(20, english, 40, 16 * 1024).toUtf8());
+  m_entries << qMakePair(QByteArray("multi-line TTITLE"), makeEntry(30, japanese, 600, 200).toUtf8());
+  // Old entries are often Latin-1, which isn't valid UTF-8
+  m_entries << qMakePair(QByteArray("Latin-1"), makeEntry(20, german, 60, 1000).toLatin1());
+
+  m_tocs << qMakePair(QByteArray("1 track"), makeToc(1));
+  m_tocs << qMakePair(QByteArray("12 tracks"), makeToc(12));
+  m_tocs << qMakePair(QByteArray("99 tracks"), makeToc(99));
+}
+
+void CDDBBenchmark::addEntries()
+{
+  QTest::addColumn<QByteArray>("data");
+  QTest::addColumn<QString>("text");
+
+  for (const auto &entry : qAsConst(m_entries))
+  {
+    const QString text = entry.first == "Latin-1" ? QString::fromLatin1(entry.second) : QString::fromUtf8(entry.second);
+    QTest::newRow(entry.first.constData()) << entry.second << text;
+  }
+}
+
+void CDDBBenchmark::addTocs()
+{
+  QTest::addColumn<TrackOffsetList>("toc");
+
+  for (const auto &toc : qAsConst(m_tocs))
+    QTest::newRow(toc.first.constData()) << toc.second;
+}
+
+void CDDBBenchmark::benchLoad_data()
+{
+  addEntries();
+}
+
+void CDDBBenchmark::benchLoad()
+{
+  QFETCH(QString, text);
+
+  QBENCHMARK {
+    CDInfo info;
+    info.load(text);
+  }
+}
+
+void CDDBBenchmark::benchLoadUtf8_data()
+{
+  addEntries();
+}
+
+void CDDBBenchmark::benchLoadUtf8()
+{
+  QFETCH(QByteArray, data);
+
+  QBENCHMARK {
+    CDInfo info;
+    info.loadUtf8(data);
+  }
+}
+
+void CDDBBenchmark::benchToString_data()
+{
+  addEntries();
+}
+
+void CDDBBenchmark::benchToString()
+{
+  QFETCH(QString, text);
+
+  CDInfo info;
+  info.load(text);
+
+  QBENCHMARK {
+    info.toString();
+  }
+}
+
+void CDDBBenchmark::benchToUtf8_data()
+{
+  addEntries();
+}
+
+void CDDBBenchmark::benchToUtf8()
+{
+  QFETCH(QString, text);
+
+  CDInfo info;
+  info.load(text);
+
+  QBENCHMARK {
+    info.toUtf8();
+  }
+}
+
+void CDDBBenchmark::benchFreedbId_data()
+{
+  addTocs();
+}
+
+void CDDBBenchmark::benchFreedbId()
+{
+  QFETCH(TrackOffsetList, toc);
+
+  QBENCHMARK {
+    CDDB::trackOffsetListToId(toc);
+  }
+}
+
+void CDDBBenchmark::benchMusicBrainzId_data()
+{
+  addTocs();
+}
+
+void CDDBBenchmark::benchMusicBrainzId()
+{
+  QFETCH(TrackOffsetList, toc);
+
+  QBENCHMARK {
+    DiscId::musicBrainzId(toc);
+  }
+}
+
+void CDDBBenchmark::benchDiscIdBatch()
+{
+  // A collection of discs, as when scanning a whole library
+  QVector<TrackOffsetList> tocs;
+  for (int i = 0; i < 1000; ++i)
+  {
+    TrackOffsetList toc = makeToc(1 + i % 30);
+    toc.last() += i;
+    tocs << toc;
+  }
+
+  QVector<DiscIds> ids(tocs.count());
+
+  QBENCHMARK {
+    DiscId::calculate(tocs.constData(), tocs.count(), ids.data());
+  }
+}
+
+QTEST_GUILESS_MAIN(CDDBBenchmark)
+
+#include "moc_cddbbenchmark.cpp"
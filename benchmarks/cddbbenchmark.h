@@ -0,0 +1,41 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef CDDBBENCHMARK_H
+#define CDDBBENCHMARK_H
+
+#include "libkcddb/kcddb.h"
+
+#include <QByteArray>
+#include <QObject>
+
+class CDDBBenchmark : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void benchLoad_data();
+    void benchLoad();
+    void benchLoadUtf8_data();
+    void benchLoadUtf8();
+    void benchToString_data();
+    void benchToString();
+    void benchToUtf8_data();
+    void benchToUtf8();
+    void benchFreedbId_data();
+    void benchFreedbId();
+    void benchMusicBrainzId_data();
+    void benchMusicBrainzId();
+    void benchDiscIdBatch();
+private:
+    void addEntries();
+    void addTocs();
+
+    QList<QPair<QByteArray, QByteArray>> m_entries;
+    QList<QPair<QByteArray, KCDDB::TrackOffsetList>> m_tocs;
+};
+
+#endif
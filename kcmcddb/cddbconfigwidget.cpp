@@ -29,7 +29,7 @@ CDDBConfigWidget::CDDBConfigWidget(QWidget * parent)
 
   tabWidget2->tabBar()->setExpanding(true);
 
-#ifndef HAVE_MUSICBRAINZ5
+#ifndef HAVE_MUSICBRAINZ
   kcfg_MusicBrainzLookupEnabled->hide();
 #endif
 
@@ -7,13 +7,16 @@
 */
 
 #include "asynccddbplookup.h"
+#include "cddbpsessionpool.h"
 #include "logging.h"
 
 namespace KCDDB
 {
   AsyncCDDBPLookup::AsyncCDDBPLookup()
     : CDDBPLookup(),
-      state_(Idle)
+      state_(Idle),
+      reusedSession_(false),
+      cdInfoParser_(cdInfo_)
   {
 
   }
@@ -27,29 +30,66 @@ namespace KCDDB
   (
     const QString         & hostname,
     uint                    port,
-    const TrackOffsetList & trackOffsetList
+    const DiscSignature   & signature
   )
+  {
+    signature_ = signature;
+    hostName_ = hostname;
+    port_ = port;
+
+    // A session left over from an earlier lookup is already past the handshake
+    socket_ = CDDBPSessionPool::take( hostname, port );
+    reusedSession_ = socket_ != nullptr;
+
+    if ( reusedSession_ )
+    {
+      watchSocket();
+      doQuery();
+      return Success;
+    }
+
+    connectToServer();
+
+    return Success;
+  }
+
+    void
+  AsyncCDDBPLookup::connectToServer()
   {
     socket_ = new QTcpSocket;
-    socket_->connectToHost(hostname, port);
+    socket_->connectToHost(hostName_, port_);
+
+    watchSocket();
 
+    state_ = WaitingForConnection;
+  }
+
+    void
+  AsyncCDDBPLookup::watchSocket()
+  {
     connect (socket_, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(slotGotError(QAbstractSocket::SocketError)));
 
     connect (socket_, &QAbstractSocket::connected,
       this, &AsyncCDDBPLookup::slotConnectionSuccess );
 
     connect (socket_, &QIODevice::readyRead, this, &AsyncCDDBPLookup::slotReadyRead );
-
-    trackOffsetList_ = trackOffsetList;
-
-    state_ = WaitingForConnection;
-
-    return Success;
   }
 
     void
   AsyncCDDBPLookup::slotGotError(QAbstractSocket::SocketError error)
   {
+    if ( reusedSession_ && WaitingForQueryResponse == state_ )
+    {
+      // The server dropped the session since it was pooled, start over
+      qCDebug(LIBKCDDB) << "Pooled session failed, reconnecting";
+
+      reusedSession_ = false;
+      socket_->disconnect( this );
+      socket_->deleteLater();
+      connectToServer();
+      return;
+    }
+
     state_ = Idle;
 
     if ( error == QAbstractSocket::HostNotFoundError )
@@ -72,7 +112,8 @@ namespace KCDDB
   {
 	qCDebug(LIBKCDDB) << "Ready to read. State: " << stateToString();
 
-    while ( Idle != state_ && isConnected() && socket_->canReadLine() )
+    while ( Idle != state_ && isConnected() &&
+        ( socket_->canReadLine() || ( WaitingForCDInfoData == state_ && socket_->bytesAvailable() > 0 ) ) )
       read();
   }
 
@@ -119,16 +160,24 @@ namespace KCDDB
       case WaitingForQueryResponse:
           result_ = parseQuery( readLine() );
 
+          // Sessions are pooled after the handshake, there's nothing left
+          // to retry once the server has answered
+          reusedSession_ = false;
+
           switch ( result_ )
           {
             case Success:
-              requestCDInfoForMatch();
+              requestCDInfo();
               break;
 
             case MultipleRecordFound:
               state_ = WaitingForMoreMatches;
               break;
 
+            case NoRecordFound:
+              finish();
+              return;
+
             default: // Error :(
               doQuit();
               return;
@@ -141,7 +190,7 @@ namespace KCDDB
           QString line = readLine();
 
           if (line.startsWith(QLatin1String( "." )))
-            requestCDInfoForMatch();
+            requestCDInfo();
           else
             parseExtraMatch( line );
         }
@@ -154,11 +203,13 @@ namespace KCDDB
 
           if ( Success != result )
           {
+            // Errors are a single line, the next response follows
             result_ = result;
-            doQuit();
+            nextCDInfo();
             return;
           }
 
+          cdInfoParser_.reset();
           state_ = WaitingForCDInfoData;
         }
 
@@ -166,15 +217,16 @@ namespace KCDDB
 
       case WaitingForCDInfoData:
         {
-          QString line = readLine();
+          // Parse whatever has arrived, up to the end of the entry. Anything
+          // after that is left in the socket for the next state.
+          const QByteArray data = socket_->peek( socket_->bytesAvailable() );
+          socket_->skip( cdInfoParser_.feed( data ) );
 
-          if (line.startsWith(QLatin1String( "." )))
+          if ( cdInfoParser_.isFinished() )
           {
             parseCDInfoData();
-            requestCDInfoForMatch();
+            nextCDInfo();
           }
-          else
-            cdInfoBuffer_ << line;
         }
 
         break;
@@ -230,18 +282,34 @@ namespace KCDDB
   }
 
     void
-  AsyncCDDBPLookup::requestCDInfoForMatch()
+  AsyncCDDBPLookup::requestCDInfo()
+  {
+    // Ask for all matches at once. The server answers in order, so reading
+    // them costs a single round trip however many there are.
+    for ( const CDDBMatch &match : qAsConst( matchList_ ) )
+      sendRead( match );
+
+    nextCDInfo();
+  }
+
+    void
+  AsyncCDDBPLookup::nextCDInfo()
   {
     if (matchList_.isEmpty())
     {
-      result_ = cdInfoList_.isEmpty()? NoRecordFound : Success;
-      doQuit();
+      if ( !cdInfoList_.isEmpty() )
+        result_ = Success;
+      else if ( ServerError != result_ )
+        result_ = NoRecordFound;
+
+      finish();
       return;
     }
 
-    CDDBMatch match = matchList_.takeFirst();
-
-    sendRead( match );
+    // The next response belongs to this match
+    const CDDBMatch match = matchList_.takeFirst();
+    category_ = match.first;
+    discid_ = match.second;
 
     state_ = WaitingForCDInfoResponse;
   }
@@ -249,17 +317,25 @@ namespace KCDDB
     void
   AsyncCDDBPLookup::parseCDInfoData()
   {
-    CDInfo info;
+    CDInfo info = cdInfo_;
 
-    if (info.load( cdInfoBuffer_ ))
-    {
-      info.set( QLatin1String( "category" ), category_ );
-      info.set( QLatin1String( "discid" ), discid_ );
-      info.set( QLatin1String( "source" ), QLatin1String( "freedb" ) );
-      cdInfoList_.append( info );
-    }
+    info.set( QLatin1String( "category" ), category_ );
+    info.set( QLatin1String( "discid" ), discid_ );
+    info.set( QLatin1String( "source" ), QLatin1String( "freedb" ) );
+    cdInfoList_.append( info );
+
+    cdInfoParser_.reset();
+  }
+
+    void
+  AsyncCDDBPLookup::finish()
+  {
+    state_ = Idle;
+
+    // The session is between commands, keep it for the next lookup
+    releaseSession();
 
-    cdInfoBuffer_.clear();
+    Q_EMIT finished( result_ );
   }
 
     void
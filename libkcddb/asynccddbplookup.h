@@ -9,6 +9,7 @@
 #define KCDDB_ASYNC_CDDBP_LOOKUP_H
 
 #include "cddbplookup.h"
+#include "cdinfoparser.h"
 
 namespace KCDDB
 {
@@ -36,7 +37,7 @@ namespace KCDDB
 
       virtual ~AsyncCDDBPLookup();
 
-      Result lookup( const QString &, uint, const TrackOffsetList & ) override;
+      Result lookup( const QString &, uint, const DiscSignature & ) override;
 
     Q_SIGNALS:
 
@@ -51,13 +52,18 @@ namespace KCDDB
 
     protected:
 
+      void connectToServer();
+      void watchSocket();
+
       void doHandshake();
       void doProto();
       void doQuery();
       void doQuit();
+      void finish();
 
       bool parseQueryResponse( const QString & );
-      void requestCDInfoForMatch();
+      void requestCDInfo();
+      void nextCDInfo();
       bool parseCDInfoResponse( const QString & );
       void parseCDInfoData();
 
@@ -71,7 +77,10 @@ namespace KCDDB
 
       State state_;
       Result result_;
-      QStringList cdInfoBuffer_;
+      // Whether socket_ came from the session pool and hasn't been used yet
+      bool reusedSession_;
+      CDInfo cdInfo_;
+      CDInfoParser cdInfoParser_;
   };
 }
 
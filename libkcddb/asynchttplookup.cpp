@@ -8,19 +8,49 @@
 #include "asynchttplookup.h"
 #include "logging.h"
 
-#include <KIO/TransferJob>
-
 namespace KCDDB
 {
+  class AsyncHTTPLookup::PendingRead
+  {
+    public:
+      explicit PendingRead( const CDDBMatch &m )
+        : match( m ), parser( info ), succeeded( false )
+      {}
+
+      CDDBMatch match;
+      CDInfo info;
+      // Parses the entry while it arrives
+      CDInfoParser parser;
+      bool succeeded;
+  };
+
   AsyncHTTPLookup::AsyncHTTPLookup()
-    : HTTPLookup()
+    : HTTPLookup(),
+      concurrentReads_( 1 ),
+      nextRead_( 0 ),
+      finishedReads_( 0 )
   {
     block_ = false;
   }
 
   AsyncHTTPLookup::~AsyncHTTPLookup()
   {
-    // Empty.
+    // Their signals would reach a lookup that's gone, and the requests
+    // would keep their connections busy
+    if ( queryJob_ )
+      queryJob_->kill();
+
+    const QList<HTTPJob *> jobs = runningReads_.keys();
+    for ( HTTPJob *job : jobs )
+      job->kill();
+
+    qDeleteAll( reads_ );
+  }
+
+    void
+  AsyncHTTPLookup::setConcurrentReads( int reads )
+  {
+    concurrentReads_ = qMax( 1, reads );
   }
 
     Result
@@ -28,13 +58,12 @@ namespace KCDDB
   (
     const QString         & hostName,
     uint                    port,
-    const TrackOffsetList & trackOffsetList
+    const DiscSignature   & signature
   )
   {
-    trackOffsetList_ = trackOffsetList;
+    signature_ = signature;
 
     connect( this, &HTTPLookup::queryReady, this, &AsyncHTTPLookup::slotQueryReady );
-    connect( this, &HTTPLookup::readReady, this, &AsyncHTTPLookup::requestCDInfoForMatch );
 
     initURL( hostName, port );
 
@@ -66,40 +95,107 @@ namespace KCDDB
       return;
     }
 
-    requestCDInfoForMatch();
+    requestCDInfo();
   }
 
     void
-  AsyncHTTPLookup::requestCDInfoForMatch()
+  AsyncHTTPLookup::requestCDInfo()
   {
-    if ( matchList_.isEmpty() )
+    qDeleteAll( reads_ );
+    reads_.clear();
+    runningReads_.clear();
+    nextRead_ = 0;
+    finishedReads_ = 0;
+
+    for ( const CDDBMatch &match : qAsConst( matchList_ ) )
+      reads_.append( new PendingRead( match ) );
+    matchList_.clear();
+
+    if ( reads_.isEmpty() )
     {
       result_ = cdInfoList_.isEmpty()? NoRecordFound : Success;
       Q_EMIT finished( result_ );
       return;
     }
 
-    CDDBMatch match = matchList_.takeFirst();
-
-    data_ = QByteArray();
     state_ = WaitingForReadResponse;
 
-    result_ = sendRead( match );
+    // Fetch several matches at once instead of waiting for each in turn
+    while ( nextRead_ < reads_.count() && runningReads_.count() < concurrentReads_ )
+      startRead();
+  }
 
-    if ( Success != result_ )
-      Q_EMIT finished( result_ );
+    void
+  AsyncHTTPLookup::startRead()
+  {
+    PendingRead *read = reads_[ nextRead_++ ];
+
+    makeURL( QString::fromLatin1( "cddb read %1 %2" ).arg( read->match.first, read->match.second ) );
+
+    runningReads_.insert( startJob(), read );
   }
 
     void
-  AsyncHTTPLookup::slotData( KIO::Job *, const QByteArray &data )
+  AsyncHTTPLookup::readFinished( HTTPJob *job )
   {
-    if (data.size() > 0)
-      data_.append(data);
+    PendingRead *read = runningReads_.take( job );
+
+    if ( 0 == job->error() )
+    {
+      read->parser.finish();
+      read->info.set( QLatin1String( "category" ), read->match.first );
+      read->info.set( QLatin1String( "discid" ), read->match.second );
+      read->info.set( QLatin1String( "source" ), QLatin1String( "freedb" ) );
+      read->succeeded = true;
+    }
+    else
+      qCDebug(LIBKCDDB) << "Couldn't read " << read->match.first << "/" << read->match.second;
+
+    ++finishedReads_;
+
+    if ( nextRead_ < reads_.count() )
+    {
+      startRead();
+      return;
+    }
+
+    if ( finishedReads_ < reads_.count() )
+      return;
+
+    // Keep the entries in the order of the matches, whatever order they arrived in
+    for ( const PendingRead *r : qAsConst( reads_ ) )
+    {
+      if ( r->succeeded )
+        cdInfoList_.append( r->info );
+    }
+
+    state_ = Idle;
+    result_ = cdInfoList_.isEmpty()? ServerError : Success;
+    Q_EMIT finished( result_ );
   }
 
     void
-  AsyncHTTPLookup::slotResult( KJob *job )
+  AsyncHTTPLookup::slotData( HTTPJob *job, const QByteArray &data )
   {
+    if (data.size() <= 0)
+      return;
+
+    // Entries are parsed as they arrive
+    if ( PendingRead *read = runningReads_.value( job ) )
+      read->parser.feed( data );
+    else
+      data_.append( data );
+  }
+
+    void
+  AsyncHTTPLookup::slotResult( HTTPJob *job )
+  {
+    if ( runningReads_.contains( job ) )
+    {
+      readFinished( job );
+      return;
+    }
+
     if ( 0 != job->error() )
     {
       result_ = ServerError;
@@ -114,19 +210,24 @@ namespace KCDDB
     Result
   AsyncHTTPLookup::fetchURL()
   {
-	qCDebug(LIBKCDDB) << "About to fetch: " << cgiURL_.url();
+    queryJob_ = startJob();
 
-    KIO::TransferJob* job = KIO::get( cgiURL_, KIO::NoReload, KIO::HideProgressInfo );
+    return Success;
+  }
+
+    HTTPJob *
+  AsyncHTTPLookup::startJob()
+  {
+	qCDebug(LIBKCDDB) << "About to fetch: " << cgiURL_.url();
 
-    if ( nullptr == job )
-      return ServerError;
+    HTTPJob* job = HTTPJob::get( cgiURL_, backend_ );
 
-    connect( job, &KIO::TransferJob::data,
+    connect( job, &HTTPJob::data,
           this, &AsyncHTTPLookup::slotData );
-    connect( job, &KJob::result,
+    connect( job, &HTTPJob::result,
           this, &AsyncHTTPLookup::slotResult );
 
-    return Success;
+    return job;
   }
 
 }
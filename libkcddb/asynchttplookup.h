@@ -10,7 +10,8 @@
 
 #include "httplookup.h"
 
-class KJob;
+#include <QHash>
+#include <QPointer>
 
 namespace KCDDB
 {
@@ -24,25 +25,47 @@ namespace KCDDB
       AsyncHTTPLookup();
       virtual ~AsyncHTTPLookup();
 
-      Result lookup( const QString &, uint, const TrackOffsetList & ) override;
+      Result lookup( const QString &, uint, const DiscSignature & ) override;
 
       CDInfoList lookupResponse() const;
 
+      /**
+       * Sets how many matches are fetched at the same time
+       */
+      void setConcurrentReads( int );
+
     Q_SIGNALS:
 
       void finished( KCDDB::Result );
 
     protected Q_SLOTS:
       void slotQueryReady();
-      void requestCDInfoForMatch();
 
-      void slotData( KIO::Job *, const QByteArray & );
-      void slotResult( KJob * );
+      void slotData( KCDDB::HTTPJob *, const QByteArray & );
+      void slotResult( KCDDB::HTTPJob * );
 
     protected:
       Result fetchURL() override;
 
       Result runQuery();
+
+      HTTPJob *startJob();
+
+      void requestCDInfo();
+      void startRead();
+      void readFinished( HTTPJob * );
+
+    private:
+      class PendingRead;
+
+      int concurrentReads_;
+      // One per match, in the order of matchList_
+      QList<PendingRead *> reads_;
+      QHash<HTTPJob *, PendingRead *> runningReads_;
+      // The query, until it has finished
+      QPointer<HTTPJob> queryJob_;
+      int nextRead_;
+      int finishedReads_;
   };
 }
 
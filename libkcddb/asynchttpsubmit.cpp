@@ -6,7 +6,6 @@
 
 #include "asynchttpsubmit.h"
 
-#include <KIO/Job>
 #include <QDebug>
 
 namespace KCDDB
@@ -22,14 +21,14 @@ namespace KCDDB
 
   }
 
-  Result AsyncHTTPSubmit::runJob(KIO::Job* job)
+  Result AsyncHTTPSubmit::runJob(HTTPJob* job)
   {
-    connect(job, &KJob::result, this, &AsyncHTTPSubmit::slotFinished);
+    connect(job, &HTTPJob::result, this, &AsyncHTTPSubmit::slotFinished);
 
     return Success;
   }
 
-  void AsyncHTTPSubmit::slotFinished(KJob* job)
+  void AsyncHTTPSubmit::slotFinished(HTTPJob* job)
   {
     qDebug() << "Finished";
 
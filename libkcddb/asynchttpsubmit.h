@@ -9,8 +9,6 @@
 
 #include "httpsubmit.h"
 
-class KJob;
-
 namespace KCDDB
 {
   class AsyncHTTPSubmit : public HTTPSubmit
@@ -23,9 +21,9 @@ namespace KCDDB
     Q_SIGNALS:
       void finished( KCDDB::Result );
     protected:
-      Result runJob(KIO::Job* job) override;
+      Result runJob(HTTPJob* job) override;
     private Q_SLOTS:
-      void slotFinished(KJob*);
+      void slotFinished(KCDDB::HTTPJob*);
   } ;
 }
 
@@ -9,48 +9,199 @@
 
 #include "cache.h"
 
+#include "cacheindex.h"
 #include "config.h"
 #include "cddb.h"
 #include "logging.h"
+#include "packedcache.h"
 
 #include "config-musicbrainz.h"
-#ifdef HAVE_MUSICBRAINZ5
+#ifdef HAVE_MUSICBRAINZ
 #include "musicbrainz/musicbrainzlookup.h"
 #endif
 
+#include <QCache>
+#include <QDateTime>
 #include <QFile>
 #include <QDir>
-#include <QTextStream>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
 
 namespace KCDDB
 {
+  namespace
+  {
+    // Already parsed lookup results, shared by all clients in the process
+    class MemoryCache
+    {
+      public:
+        QMutex mutex;
+        QCache<QString, CDInfoList> entries;
+    };
+
+    Q_GLOBAL_STATIC(MemoryCache, s_memoryCache)
+
+      QString
+    tocString( const TrackOffsetList &offsetList )
+    {
+      QString toc;
+      for (uint offset : offsetList) {
+        if (!toc.isEmpty())
+          toc += QLatin1Char( ' ' );
+        toc += QString::number(offset);
+      }
+      return toc;
+    }
+
+      QString
+    memoryCacheKey( const DiscSignature &signature, const Config &c )
+    {
+      // Different configurations may read different cache locations. The
+      // disc ids let entries stored without a TOC find the key again.
+      return c.cacheLocations().join(QLatin1Char( ':' )) + QLatin1Char( ' ' ) + signature.freedbId()
+        + QLatin1Char( ' ' ) + signature.musicBrainzId() + QLatin1Char( ' ' ) + tocString(signature.trackOffsetList());
+    }
+
+    // Forgets the parsed results of all discs with the freedb or MusicBrainz id @p discid
+      void
+    removeFromMemoryCache( const QString &discid )
+    {
+      if (discid.isEmpty())
+        return;
+
+      const QString id = QLatin1Char( ' ' ) + discid + QLatin1Char( ' ' );
+
+      QMutexLocker locker(&s_memoryCache->mutex);
+
+      const QList<QString> keys = s_memoryCache->entries.keys();
+      for (const QString &key : keys) {
+        if (key.contains(id))
+          s_memoryCache->entries.remove(key);
+      }
+    }
+
+    // Name of an entry relative to its cache location, e.g. "misc/a1107d0a",
+    // or "misc/a1/10/a1107d0a" in the sharded layout
+      QString
+    entryName( const QString &category, const QString &file, bool sharded )
+    {
+      if (!sharded || file.length() < 4)
+        return category + QLatin1Char( '/' ) + file;
+
+      return category + QLatin1Char( '/' ) + file.left(2) + QLatin1Char( '/' )
+        + file.mid(2, 2) + QLatin1Char( '/' ) + file;
+    }
+
+      QString
+    negativeFileName( const QString &cacheDir, const QString &discid )
+    {
+      return cacheDir + QLatin1String( "/negative/" ) + discid;
+    }
+
+    // Entries stored without a TOC, see Cache::storeRelated(), can't remove
+    // the negative entry of their disc, but they do show up in the index
+      bool
+    hasEntries( const DiscSignature &signature, const Config &c )
+    {
+      const QStringList cacheLocations = c.cacheLocations();
+      for (const QString &cacheDir : cacheLocations) {
+        if (!CacheIndex::entries(cacheDir, signature.musicBrainzId()).isEmpty())
+          return true;
+      }
+
+      return false;
+    }
+  }
+
     CDInfoList
-  Cache::lookup( const TrackOffsetList &offsetList, const Config& c )
+  Cache::lookup( const DiscSignature &signature, const Config& c )
   {
-    QString cddbId = CDDB::trackOffsetListToId(offsetList);
+    const QString cddbId = signature.freedbId();
 
 	qCDebug(LIBKCDDB) << "Looking up " << cddbId << " in CDDB cache";
 
+    const int memoryCacheSize = c.memoryCacheSize();
+    const QString key = memoryCacheSize > 0 ? memoryCacheKey(signature, c) : QString();
+
+    if (memoryCacheSize > 0)
+    {
+      QMutexLocker locker(&s_memoryCache->mutex);
+      s_memoryCache->entries.setMaxCost(memoryCacheSize);
+
+      if (const CDInfoList *cached = s_memoryCache->entries.object(key))
+      {
+        qCDebug(LIBKCDDB) << "Found " << cddbId << " in memory cache";
+        return *cached;
+      }
+    }
+
     CDInfoList infoList;
 
-    infoList << CDDB::cacheFiles(offsetList, c);
-#ifdef HAVE_MUSICBRAINZ5
-    infoList << MusicBrainzLookup::cacheFiles(offsetList, c);
+    infoList << CDDB::cacheFiles(signature, c);
+#ifdef HAVE_MUSICBRAINZ
+    infoList << MusicBrainzLookup::cacheFiles(signature, c);
 #endif
 
+    if (memoryCacheSize > 0 && !infoList.isEmpty())
+    {
+      QMutexLocker locker(&s_memoryCache->mutex);
+      s_memoryCache->entries.insert(key, new CDInfoList(infoList));
+    }
+
     return infoList;
   }
 
     void
-  Cache::store(const TrackOffsetList& offsetList, const CDInfoList& list, const Config& c)
+  Cache::store(const DiscSignature& signature, const CDInfoList& list, const Config& c)
   {
     for (const CDInfo &info : list) {
-      store(offsetList, info, c);
+      store(signature, info, c);
     }
   }
 
     void
-  Cache::store(const TrackOffsetList& offsetList, const CDInfo& info, const Config& c)
+  Cache::store(const DiscSignature& signature, const CDInfo& info, const Config& c)
+  {
+    {
+      // The next lookup has to see the new entry
+      QMutexLocker locker(&s_memoryCache->mutex);
+      s_memoryCache->entries.remove(memoryCacheKey(signature, c));
+    }
+
+    const QStringList locations = c.cacheLocations();
+    if (!locations.isEmpty())
+      QFile::remove(negativeFileName(locations.first(), signature.freedbId()));
+
+    write(info, signature.freedbId(), c);
+  }
+
+    void
+  Cache::storeRelated(const CDInfoList& list, const Config& c)
+  {
+    for (const CDInfo &info : list) {
+      const QString source = info.get(QLatin1String( "source" )).toString();
+      if (source != QLatin1String( "freedb" ) && source != QLatin1String( "musicbrainz" ))
+      {
+        qCWarning(LIBKCDDB) << "Can't store " << source << " entries without a TOC";
+        continue;
+      }
+
+      // The next lookup of the disc has to see the new entry
+      const QString discid = CacheIndex::keyForFile(source, info.get(QLatin1String( "discid" )).toString());
+      removeFromMemoryCache(discid);
+
+      const QStringList locations = c.cacheLocations();
+      if (!locations.isEmpty() && source == QLatin1String( "freedb" ))
+        QFile::remove(negativeFileName(locations.first(), discid));
+
+      write(info, QString(), c);
+    }
+  }
+
+    void
+  Cache::write(const CDInfo& info, const QString& freedbId, const Config& c)
   {
     QString discid = info.get(QLatin1String( "discid" )).toString();
 
@@ -63,25 +214,25 @@ namespace KCDDB
       for (const QString &newid : discids) {
         CDInfo newInfo = info;
         newInfo.set(QLatin1String( "discid" ), newid);
-        store(offsetList, newInfo, c);
+        write(newInfo, freedbId, c);
       }
     }
 
     QString source = info.get(QLatin1String( "source" )).toString();
 
-    QString cacheDir;
+    QString category;
     QString cacheFile;
 
     CDInfo newInfo = info;
 
     if (source == QLatin1String( "freedb" ))
     {
-      cacheDir = QLatin1Char( '/' ) + info.get(QLatin1String( "category" )).toString() + QLatin1Char( '/' );
+      category = info.get(QLatin1String( "category" )).toString();
       cacheFile = discid;
     }
     else if (source == QLatin1String( "musicbrainz" ))
     {
-      cacheDir = QLatin1String( "/musicbrainz/" );
+      category = QLatin1String( "musicbrainz" );
       cacheFile = discid;
     }
     else
@@ -89,44 +240,205 @@ namespace KCDDB
       if (source != QLatin1String( "user" ))
 		qCWarning(LIBKCDDB) << "Unknown source " << source << " for CDInfo";
 
-      cacheDir = QLatin1String( "/user/" );
-      QString id = CDDB::trackOffsetListToId(offsetList);
-      cacheFile = id;
-      newInfo.set(QLatin1String( "discid" ), id);
+      category = QLatin1String( "user" );
+      cacheFile = freedbId;
+      newInfo.set(QLatin1String( "discid" ), freedbId);
     }
 
     const QStringList cacheLocations = c.cacheLocations();
 
     if (!cacheLocations.isEmpty()) {
-      cacheDir = cacheLocations.first() + cacheDir;
+      const bool sharded = c.shardedCacheLayout() && c.cacheBackend() != Config::EnumCacheBackend::Packed;
+      const QString entry = entryName(category, cacheFile, sharded);
 
-      QDir dir;
+	    qCDebug(LIBKCDDB) << "Storing " << cacheFile << " in CDDB cache";
 
-      if (!dir.exists(cacheDir))
+      if (c.cacheBackend() == Config::EnumCacheBackend::Packed)
       {
-        if (!dir.mkpath(cacheDir))
-        {
-		      qCWarning(LIBKCDDB) << "Couldn't create cache directory " << cacheDir;
+        if (!QDir().mkpath(cacheLocations.first())
+            || !PackedCache::write(cacheLocations.first(), entry, newInfo.toUtf8()))
           return;
-        }
       }
+      else
+      {
+        const QString fileName = cacheLocations.first() + QLatin1Char( '/' ) + entry;
+        const QString cacheDir = QFileInfo(fileName).path();
 
-	    qCDebug(LIBKCDDB) << "Storing " << cacheFile << " in CDDB cache";
+        QDir dir;
 
-      QFile f(cacheDir + QLatin1Char( '/' ) + cacheFile);
-      if ( f.open(QIODevice::WriteOnly) )
-      {
-        QTextStream ts(&f);
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-        ts.setCodec("UTF-8");
-#endif
-        ts << newInfo.toString();
+        if (!dir.exists(cacheDir))
+        {
+          if (!dir.mkpath(cacheDir))
+          {
+		        qCWarning(LIBKCDDB) << "Couldn't create cache directory " << cacheDir;
+            return;
+          }
+        }
+
+        QFile f(fileName);
+        if ( !f.open(QIODevice::WriteOnly) )
+          return;
+
+        f.write(newInfo.toUtf8());
         f.close();
+
+        // The packed store is read first, don't let it hide the new entry
+        PackedCache::remove(cacheLocations.first(), entry);
+        // Nor should the entry show up twice if the layout was changed
+        QFile::remove(cacheLocations.first() + QLatin1Char( '/' ) + entryName(category, cacheFile, !sharded));
       }
+
+      CacheIndex::insert(cacheLocations.first(), CacheIndex::keyForFile(category, cacheFile), entry);
     } else {
       qDebug() << "There's no cache dir defined, not storing it";
     }
   }
+
+    bool
+  Cache::lookupNegative(const DiscSignature& signature, const Config& c)
+  {
+    const int ttl = c.negativeCacheTTL();
+    if (ttl <= 0)
+      return false;
+
+    const QString discid = signature.freedbId();
+    const QByteArray toc = tocString(signature.trackOffsetList()).toLatin1();
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+
+    const QStringList cacheLocations = c.cacheLocations();
+    for (const QString &cacheDir : cacheLocations) {
+      QFile f(negativeFileName(cacheDir, discid));
+      if (!f.open(QIODevice::ReadOnly))
+        continue;
+
+      // Each line is "<time of the failed lookup> <track offsets>"
+      while (!f.atEnd())
+      {
+        const QByteArray line = f.readLine().trimmed();
+        const int space = line.indexOf(' ');
+        if (space <= 0 || line.mid(space + 1) != toc)
+          continue;
+
+        const qint64 stored = line.left(space).toLongLong();
+        if (now - stored < ttl && !hasEntries(signature, c))
+        {
+          qCDebug(LIBKCDDB) << discid << " is known to be missing since " << stored;
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+    void
+  Cache::storeNegative(const DiscSignature& signature, const Config& c)
+  {
+    const int ttl = c.negativeCacheTTL();
+    const QStringList cacheLocations = c.cacheLocations();
+    if (ttl <= 0 || cacheLocations.isEmpty())
+      return;
+
+    const QString cacheDir = cacheLocations.first() + QLatin1String( "/negative/" );
+    if (!QDir().mkpath(cacheDir))
+    {
+      qCWarning(LIBKCDDB) << "Couldn't create cache directory " << cacheDir;
+      return;
+    }
+
+    const QString discid = signature.freedbId();
+    const QByteArray toc = tocString(signature.trackOffsetList()).toLatin1();
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+
+    // Keep the unexpired entries of other discs sharing the freedb id
+    QByteArray data;
+    QFile f(negativeFileName(cacheLocations.first(), discid));
+    if (f.open(QIODevice::ReadOnly))
+    {
+      while (!f.atEnd())
+      {
+        const QByteArray line = f.readLine().trimmed();
+        const int space = line.indexOf(' ');
+        if (space <= 0 || line.mid(space + 1) == toc || now - line.left(space).toLongLong() >= ttl)
+          continue;
+
+        data += line + '\n';
+      }
+      f.close();
+    }
+
+    data += QByteArray::number(now) + ' ' + toc + '\n';
+
+    qCDebug(LIBKCDDB) << "Storing " << discid << " as missing in CDDB cache";
+
+    if (f.open(QIODevice::WriteOnly))
+      f.write(data);
+  }
+
+    void
+  Cache::rebuildIndex(const Config& c)
+  {
+    const QStringList cacheLocations = c.cacheLocations();
+    for (const QString &cacheDir : cacheLocations) {
+      CacheIndex::rebuild(cacheDir);
+    }
+
+    // The entries have changed behind our back
+    QMutexLocker locker(&s_memoryCache->mutex);
+    s_memoryCache->entries.clear();
+  }
+
+    void
+  Cache::migrateLayout(const Config& c)
+  {
+    const bool sharded = c.shardedCacheLayout();
+
+    const QStringList cacheLocations = c.cacheLocations();
+    for (const QString &cacheDir : cacheLocations) {
+      QDir location(cacheDir);
+      const QStringList categories = location.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+
+      for (const QString &category : categories) {
+        if (category == QLatin1String( "negative" ) || category == CacheIndex::directoryName())
+          continue;
+
+        QStringList shardDirs;
+
+        QDirIterator it(location.filePath(category), QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext())
+        {
+          const QString oldName = it.next();
+          const QString newName = location.filePath(entryName(category, it.fileName(), sharded));
+          if (oldName == newName)
+            continue;
+
+          const QString oldDir = QFileInfo(oldName).path();
+          if (oldDir != location.filePath(category) && !shardDirs.contains(oldDir))
+            shardDirs << oldDir;
+
+          if (!QDir().mkpath(QFileInfo(newName).path()))
+          {
+            qCWarning(LIBKCDDB) << "Couldn't create cache directory " << QFileInfo(newName).path();
+            continue;
+          }
+
+          // An entry that exists in both layouts was written last in the new one
+          if (QFile::exists(newName))
+            QFile::remove(oldName);
+          else if (!QFile::rename(oldName, newName))
+            qCWarning(LIBKCDDB) << "Couldn't move " << oldName << " to " << newName;
+        }
+
+        // Clean up the shard directories that were emptied, innermost first
+        for (const QString &dir : qAsConst(shardDirs)) {
+          QDir().rmdir(dir);
+          QDir().rmdir(QFileInfo(dir).path());
+        }
+      }
+    }
+
+    rebuildIndex(c);
+  }
 }
 
 // vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -11,6 +11,7 @@
 
 #include "kcddb.h"
 #include "cdinfo.h"
+#include "discsignature.h"
 
 #include <QString>
 
@@ -21,12 +22,43 @@ namespace KCDDB
   class KCDDB_EXPORT Cache
   {
     public:
-      static CDInfoList lookup( const TrackOffsetList & , const Config & );
-      static void store( const TrackOffsetList &, const CDInfoList &, const Config & );
-      static void store( const TrackOffsetList &, const CDInfo &, const Config & );
+      static CDInfoList lookup( const DiscSignature & , const Config & );
+      static void store( const DiscSignature &, const CDInfoList &, const Config & );
+      static void store( const DiscSignature &, const CDInfo &, const Config & );
+      /**
+       * Stores entries of other discs that were found on the way, such as
+       * the other discs of a MusicBrainz release. They are known by their
+       * disc id only, so only freedb and MusicBrainz entries can be stored.
+       */
+      static void storeRelated( const CDInfoList &, const Config & );
+
+      /**
+       * @return true if no source knew the disc the last time it was looked
+       * up, and that was less than Config::negativeCacheTTL() seconds ago
+       */
+      static bool lookupNegative( const DiscSignature &, const Config & );
+      /**
+       * Remembers that no source knows the disc, so it isn't looked up again
+       * until Config::negativeCacheTTL() seconds have passed
+       */
+      static void storeNegative( const DiscSignature &, const Config & );
+
+      /**
+       * Scans the cache locations again and rewrites their disc id index.
+       * Entries added to the cache by other means than store() are also
+       * found without it, by the first lookup of their disc
+       */
+      static void rebuildIndex( const Config & );
+
+      /**
+       * Moves the entry files of all cache locations into the layout
+       * selected by Config::shardedCacheLayout()
+       */
+      static void migrateLayout( const Config & );
 
     private:
       static QString fileName( const QString &category, const QString& discid, const QString &cacheDir );
+      static void write( const CDInfo &, const QString &freedbId, const Config & );
   };
 }
 
@@ -0,0 +1,382 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "cacheindex.h"
+#include "logging.h"
+#include "packedcache.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QSaveFile>
+
+namespace KCDDB
+{
+  namespace
+  {
+    // Length of a MusicBrainz disc id; longer file names in the musicbrainz
+    // directory are additional releases, stored as discid-2, discid-3 and so on
+    const int musicBrainzIdLength = 28;
+
+    const int bucketCount = 256;
+
+    class BucketIndex
+    {
+      public:
+        BucketIndex()
+          : size(-1)
+        {}
+
+        QHash<QString, QStringList> entries;
+        // Bytes of the bucket file that have been read so far
+        qint64 size;
+        // The first line of the bucket file, which changes whenever the
+        // file is rewritten
+        QByteArray generation;
+    };
+
+    class LocationIndex
+    {
+      public:
+        // Only the buckets that were looked at, by name
+        QHash<QString, BucketIndex> buckets;
+    };
+
+    class IndexCache
+    {
+      public:
+        QMutex mutex;
+        QHash<QString, LocationIndex> locations;
+    };
+
+    Q_GLOBAL_STATIC(IndexCache, s_indexCache)
+
+      QString
+    indexDirName( const QString &cacheDir )
+    {
+      return cacheDir + QLatin1Char( '/' ) + CacheIndex::directoryName();
+    }
+
+      QString
+    bucketFileName( const QString &cacheDir, const QString &bucket )
+    {
+      return indexDirName( cacheDir ) + QLatin1Char( '/' ) + bucket;
+    }
+
+    // The same in every process, unlike qHash()
+      QString
+    bucketName( const QString &discid )
+    {
+      quint32 hash = 2166136261u;
+      const QByteArray key = discid.toUtf8();
+      for ( char c : key )
+        hash = ( hash ^ uchar( c ) ) * 16777619u;
+
+      return QString::number( hash % bucketCount, 16 ).rightJustified( 2, QLatin1Char( '0' ) );
+    }
+
+      QByteArray
+    newGeneration()
+    {
+      return '#' + QByteArray::number( QRandomGenerator::global()->generate64(), 16 ) + '\n';
+    }
+
+      QByteArray
+    indexLine( const QString &discid, const QString &entry )
+    {
+      return discid.toUtf8() + ' ' + entry.toUtf8() + '\n';
+    }
+
+      void
+    addEntry( BucketIndex &bucket, const QString &discid, const QString &entry )
+    {
+      QStringList &list = bucket.entries[ discid ];
+      if ( !list.contains( entry ) )
+        list.append( entry );
+    }
+
+      void
+    scan( LocationIndex &index, const QString &cacheDir )
+    {
+      QHash<QString, BucketIndex> buckets;
+
+      QDir dir( cacheDir );
+      QDirIterator it( cacheDir, QDir::Files, QDirIterator::Subdirectories );
+      while ( it.hasNext() )
+      {
+        const QString entry = dir.relativeFilePath( it.next() );
+        const int slash = entry.indexOf( QLatin1Char( '/' ) );
+
+        // Files at the top level aren't entries, e.g. the packed store
+        if ( -1 == slash )
+          continue;
+
+        const QString category = entry.left( slash );
+
+        // Discs no source knew, see Cache::storeNegative(), and the index itself
+        if ( category == QLatin1String( "negative" ) || category == CacheIndex::directoryName() )
+          continue;
+
+        const QString discid = CacheIndex::keyForFile( category, it.fileName() );
+        addEntry( buckets[ bucketName( discid ) ], discid, entry );
+      }
+
+      const QStringList packedEntries = PackedCache::entries( cacheDir );
+      for ( const QString &entry : packedEntries )
+      {
+        const int slash = entry.indexOf( QLatin1Char( '/' ) );
+        const QString discid = CacheIndex::keyForFile( entry.left( slash ), entry.mid( slash + 1 ) );
+        addEntry( buckets[ bucketName( discid ) ], discid, entry );
+      }
+
+      // Buckets left over from before have to be emptied as well
+      const QStringList oldBuckets = QDir( indexDirName( cacheDir ) ).entryList( QDir::Files );
+      for ( const QString &bucket : oldBuckets )
+      {
+        if ( !buckets.contains( bucket ) )
+          buckets.insert( bucket, BucketIndex() );
+      }
+
+      index.buckets.clear();
+
+      if ( !QDir().mkpath( indexDirName( cacheDir ) ) )
+        qCDebug(LIBKCDDB) << "Couldn't create cache index for " << cacheDir;
+
+      // Each bucket is replaced in one go under a new generation, so other
+      // processes notice and read it from the start
+      for ( auto bucket = buckets.begin(); bucket != buckets.end(); ++bucket )
+      {
+        QSaveFile f( bucketFileName( cacheDir, bucket.key() ) );
+        if ( f.open( QIODevice::WriteOnly ) )
+        {
+          f.write( newGeneration() );
+
+          for ( auto entries = bucket->entries.constBegin(); entries != bucket->entries.constEnd(); ++entries )
+          {
+            for ( const QString &entry : entries.value() )
+              f.write( indexLine( entries.key(), entry ) );
+          }
+
+          // Read back when it's needed
+          if ( f.commit() )
+            continue;
+        }
+
+        qCDebug(LIBKCDDB) << "Couldn't write cache index for " << cacheDir;
+
+        // Without a file, this process at least keeps what it found
+        if ( !bucket->entries.isEmpty() )
+          index.buckets.insert( bucket.key(), bucket.value() );
+      }
+
+      // The single file index of older versions
+      QFile::remove( cacheDir + QLatin1String( "/index" ) );
+    }
+
+    // Reads whatever has been appended to the bucket file since the last
+    // call, or all of it if it has been replaced
+      void
+    updateBucket( BucketIndex &bucket, const QString &fileName )
+    {
+      QFile f( fileName );
+      if ( !f.open( QIODevice::ReadOnly ) )
+        return;
+
+      // Only QSaveFile writes the first line of a file that's being
+      // replaced, so it's always complete
+      const QByteArray generation = f.readLine();
+      if ( !generation.startsWith( '#' ) || !generation.endsWith( '\n' ) )
+        return;
+
+      const qint64 size = f.size();
+
+      if ( generation != bucket.generation || bucket.size < 0 || size < bucket.size )
+      {
+        bucket.entries.clear();
+        bucket.generation = generation;
+        bucket.size = generation.size();
+      }
+
+      if ( size == bucket.size || !f.seek( bucket.size ) )
+        return;
+
+      while ( !f.atEnd() )
+      {
+        const QByteArray line = f.readLine();
+
+        // Another process may be in the middle of appending this line
+        if ( !line.endsWith( '\n' ) )
+          break;
+
+        bucket.size += line.size();
+
+        // Processes creating the file at the same time each write a generation
+        if ( line.startsWith( '#' ) )
+          continue;
+
+        const int space = line.indexOf( ' ' );
+        if ( space <= 0 )
+          continue;
+
+        addEntry( bucket, QString::fromUtf8( line.constData(), space ),
+            QString::fromUtf8( line.constData() + space + 1, line.size() - space - 2 ) );
+      }
+    }
+
+      BucketIndex &
+    update( LocationIndex &index, const QString &cacheDir, const QString &discid )
+    {
+      const QString name = bucketName( discid );
+      BucketIndex &bucket = index.buckets[ name ];
+      updateBucket( bucket, bucketFileName( cacheDir, name ) );
+
+      return bucket;
+    }
+
+      void
+    append( BucketIndex &bucket, const QString &cacheDir, const QString &discid, const QString &entry )
+    {
+      if ( bucket.entries.value( discid ).contains( entry ) )
+        return;
+
+      QFile f( bucketFileName( cacheDir, bucketName( discid ) ) );
+      if ( QDir().mkpath( indexDirName( cacheDir ) ) && f.open( QIODevice::WriteOnly | QIODevice::Append ) )
+      {
+        QByteArray line = indexLine( discid, entry );
+        if ( f.size() == 0 )
+          line.prepend( newGeneration() );
+
+        // One write per line, so concurrent writers don't interleave
+        f.write( line );
+        f.close();
+      }
+      else
+        qCDebug(LIBKCDDB) << "Couldn't update cache index for " << cacheDir;
+
+      addEntry( bucket, discid, entry );
+    }
+
+      QStringList
+    findEntries( const QString &cacheDir, const QString &discid )
+    {
+      QStringList found;
+
+      const QDir dir( cacheDir );
+      const QStringList categories = dir.entryList( QDir::Dirs | QDir::NoDotAndDotDot );
+      for ( const QString &category : categories )
+      {
+        if ( category == QLatin1String( "negative" ) || category == CacheIndex::directoryName() )
+          continue;
+
+        // The flat and the sharded layout, e.g. "misc/a1107d0a" and "misc/a1/10/a1107d0a"
+        QStringList subDirs( category );
+        if ( discid.length() >= 4 )
+          subDirs << category + QLatin1Char( '/' ) + discid.left( 2 ) + QLatin1Char( '/' ) + discid.mid( 2, 2 );
+
+        for ( const QString &subDir : qAsConst( subDirs ) )
+        {
+          if ( category == QLatin1String( "musicbrainz" ) )
+          {
+            const QStringList files = QDir( dir.filePath( subDir ) ).entryList(
+                QStringList( discid + QLatin1Char( '*' ) ), QDir::Files );
+            for ( const QString &file : files )
+            {
+              if ( CacheIndex::keyForFile( category, file ) == discid )
+                found << subDir + QLatin1Char( '/' ) + file;
+            }
+          }
+          else if ( QFileInfo::exists( dir.filePath( subDir + QLatin1Char( '/' ) + discid ) ) )
+            found << subDir + QLatin1Char( '/' ) + discid;
+        }
+      }
+
+      const QStringList packedEntries = PackedCache::entries( cacheDir );
+      for ( const QString &entry : packedEntries )
+      {
+        const int slash = entry.indexOf( QLatin1Char( '/' ) );
+        if ( CacheIndex::keyForFile( entry.left( slash ), entry.mid( slash + 1 ) ) == discid )
+          found << entry;
+      }
+
+      return found;
+    }
+  }
+
+    QStringList
+  CacheIndex::entries( const QString &cacheDir, const QString &discid )
+  {
+    const QString dir = QDir::cleanPath( cacheDir );
+
+    QMutexLocker locker( &s_indexCache->mutex );
+
+    LocationIndex &index = s_indexCache->locations[ dir ];
+    return update( index, dir, discid ).entries.value( discid );
+  }
+
+    QStringList
+  CacheIndex::probe( const QString &cacheDir, const QString &discid )
+  {
+    const QString dir = QDir::cleanPath( cacheDir );
+
+    // Outside the lock, so other lookups don't wait for the filesystem
+    const QStringList found = findEntries( dir, discid );
+    if ( found.isEmpty() )
+      return found;
+
+    QMutexLocker locker( &s_indexCache->mutex );
+
+    LocationIndex &index = s_indexCache->locations[ dir ];
+    BucketIndex &bucket = update( index, dir, discid );
+
+    for ( const QString &entry : found )
+      append( bucket, dir, discid, entry );
+
+    return found;
+  }
+
+    void
+  CacheIndex::insert( const QString &cacheDir, const QString &discid, const QString &entry )
+  {
+    const QString dir = QDir::cleanPath( cacheDir );
+
+    QMutexLocker locker( &s_indexCache->mutex );
+
+    LocationIndex &index = s_indexCache->locations[ dir ];
+    append( update( index, dir, discid ), dir, discid, entry );
+  }
+
+    void
+  CacheIndex::rebuild( const QString &cacheDir )
+  {
+    const QString dir = QDir::cleanPath( cacheDir );
+
+    QMutexLocker locker( &s_indexCache->mutex );
+
+    scan( s_indexCache->locations[ dir ], dir );
+  }
+
+    QString
+  CacheIndex::keyForFile( const QString &category, const QString &fileName )
+  {
+    if ( category == QLatin1String( "musicbrainz" ) )
+      return fileName.left( musicBrainzIdLength );
+
+    return fileName;
+  }
+
+    QString
+  CacheIndex::directoryName()
+  {
+    return QStringLiteral( "index.d" );
+  }
+}
+
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
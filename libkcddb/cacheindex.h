@@ -0,0 +1,69 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCDDB_CACHEINDEX_H
+#define KCDDB_CACHEINDEX_H
+
+#include <QString>
+#include <QStringList>
+
+namespace KCDDB
+{
+  /**
+   * Maps disc ids to the entries stored in a cache location, so a lookup
+   * doesn't have to probe every category directory for the disc.
+   *
+   * The index lives in the directoryName() directory of each cache
+   * location, split into 256 bucket files by a hash of the disc id, so a
+   * lookup only reads the bucket of its disc. Each bucket starts with a
+   * generation line and has one "discid category/file" line per entry.
+   * Buckets are appended to when entries are stored, and replaced with a
+   * new generation when the index is rebuilt from the directory tree.
+   *
+   * Entries written by older versions, other programs or by hand aren't
+   * in the index until probe() finds them or the index is rebuilt.
+   */
+  class CacheIndex
+  {
+    public:
+      /**
+       * @return the entries stored for @p discid, relative to @p cacheDir
+       */
+      static QStringList entries( const QString &cacheDir, const QString &discid );
+
+      /**
+       * Looks in the category directories and the packed store of
+       * @p cacheDir for entries of @p discid, and adds the ones the index
+       * doesn't list yet to it
+       * @return the entries that were found
+       */
+      static QStringList probe( const QString &cacheDir, const QString &discid );
+
+      /**
+       * Records that @p entry (relative to @p cacheDir) holds data for @p discid
+       */
+      static void insert( const QString &cacheDir, const QString &discid, const QString &entry );
+
+      /**
+       * Throws away the index of @p cacheDir and scans the directory tree again
+       */
+      static void rebuild( const QString &cacheDir );
+
+      /**
+       * @return the key an entry file called @p fileName is indexed under
+       */
+      static QString keyForFile( const QString &category, const QString &fileName );
+
+      /**
+       * @return the name of the directory holding the index, which isn't a
+       * category
+       */
+      static QString directoryName();
+  };
+}
+
+#endif // KCDDB_CACHEINDEX_H
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
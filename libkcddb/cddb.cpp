@@ -8,10 +8,14 @@
 
 #include "cddb.h"
 
+#include "cacheindex.h"
 #include "categories.h"
+#include "discid.h"
 #include "kcddbi18n.h"
+#include "packedcache.h"
 
 
+#include <QFile>
 #include <QStringList>
 
 namespace KCDDB
@@ -29,60 +33,10 @@ namespace KCDDB
     // Empty.
   }
 
-    QString
-  CDDB::trackOffsetListToId()
-  {
-    return trackOffsetListToId( trackOffsetList_ );
-  }
     QString
   CDDB::trackOffsetListToId( const TrackOffsetList & list )
   {
-    // Taken from version by Michael Matz in kio_audiocd.
-    unsigned int id = 0;
-    if ( list.isEmpty() )
-        return QString();
-    int numTracks = list.count() - 1;
-
-    // The last two in the list are disc begin and disc end.
-    for ( int i = numTracks-1; i >= 0; i-- )
-    {
-      int n = list[ i ]/75;
-      while ( n > 0 )
-      {
-        id += n % 10;
-        n /= 10;
-      }
-    }
-
-    unsigned int l = list[numTracks] / 75;
-    l -= list[0] / 75;
-
-    id = ( ( id % 255 ) << 24 ) | ( l << 8 ) | numTracks;
-
-    return QString::number( id, 16 ).rightJustified( 8, QLatin1Char( '0' ) );
-  }
-
-    QString
-  CDDB::trackOffsetListToString()
-  {
-    QString ret;
-    uint numTracks = trackOffsetList_.count()-1;
-
-    // Disc start.
-    ret.append( QString::number( numTracks ) );
-    ret.append( QLatin1String( " " ) );
-
-    for ( uint i = 0; i < numTracks; i++ )
-    {
-      ret.append( QString::number( trackOffsetList_[ i ] ) );
-      ret.append( QLatin1String( " " ) );
-    }
-
-    unsigned int discLengthInSec = ( trackOffsetList_[ numTracks ] ) / 75;
-
-    ret.append( QString::number( discLengthInSec ) );
-
-    return ret;
+    return DiscId::freedbIdString( list );
   }
 
     uint
@@ -97,7 +51,7 @@ namespace KCDDB
   }
 
     CDInfoList
-  CDDB::cacheFiles(const TrackOffsetList &offsetList, const Config& config )
+  CDDB::cacheFiles(const DiscSignature &signature, const Config& config )
   {
     Categories c;
     QStringList categories = c.cddbList();
@@ -106,39 +60,78 @@ namespace KCDDB
 
     CDInfoList infoList;
     QStringList cddbCacheDirs = config.cacheLocations();
+    const QString discid = signature.freedbId();
 
     for (QStringList::const_iterator cddbCacheDir = cddbCacheDirs.constBegin();
         cddbCacheDir != cddbCacheDirs.constEnd(); ++cddbCacheDir)
     {
-      for (const QString &category : qAsConst(categories)) {
-        QFile f( *cddbCacheDir + QLatin1Char( '/' ) + category + QLatin1Char( '/' ) + trackOffsetListToId(offsetList) );
-        if ( f.exists() && f.open(QIODevice::ReadOnly) )
-        {
-            QTextStream ts(&f);
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-            ts.setCodec("UTF-8");
-#endif
-            QString cddbData = ts.readAll();
-            f.close();
-            CDInfo info;
-            info.load(cddbData);
-            if (category != QLatin1String( "user" ))
-            {
-              info.set(Category,category);
-              info.set(QLatin1String( "source" ), QLatin1String( "freedb" ));
-            }
-            else
+      const QString cacheDir = *cddbCacheDir;
+
+      // Appends what @p entries hold for each category, returns false if nothing
+      auto readEntries = [&](const QStringList &entries)
+      {
+        bool foundAny = false;
+
+        for (const QString &category : qAsConst(categories)) {
+          // Either "misc/a1107d0a" or, in the sharded layout, "misc/a1/10/a1107d0a"
+          const QString prefix = category + QLatin1Char( '/' );
+          const QString suffix = QLatin1Char( '/' ) + discid;
+
+          QByteArray cddbData;
+          bool found = false;
+          for (const QString &entry : entries) {
+            if (entry.startsWith(prefix) && entry.endsWith(suffix)
+                && readCacheEntry(cacheDir, entry, cddbData))
             {
-              info.set(QLatin1String( "source" ), QLatin1String( "user" ));
+              found = true;
+              break;
             }
-
-            infoList.append( info );
+          }
+
+          if ( found )
+          {
+              CDInfo info;
+              info.loadUtf8(cddbData);
+              if (category != QLatin1String( "user" ))
+              {
+                info.set(Category,category);
+                info.set(QLatin1String( "source" ), QLatin1String( "freedb" ));
+              }
+              else
+              {
+                info.set(QLatin1String( "source" ), QLatin1String( "user" ));
+              }
+
+              infoList.append( info );
+              foundAny = true;
+          }
         }
-      }
+
+        return foundAny;
+      };
+
+      // Entries the index doesn't know about, e.g. written by older
+      // versions or copied into the cache by hand
+      if (!readEntries(CacheIndex::entries(cacheDir, discid)))
+        readEntries(CacheIndex::probe(cacheDir, discid));
     }
 
     return infoList;
   }
+
+    bool
+  CDDB::readCacheEntry(const QString &cacheDir, const QString &entry, QByteArray &data)
+  {
+    if (PackedCache::read(cacheDir, entry, data))
+      return true;
+
+    QFile f( cacheDir + QLatin1Char( '/' ) + entry );
+    if ( !f.open(QIODevice::ReadOnly) )
+      return false;
+
+    data = f.readAll();
+    return true;
+  }
 }
 
 // vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
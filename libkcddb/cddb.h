@@ -10,14 +10,16 @@
 #define KCDDB_CDDB_H
 
 #include "kcddb.h"
+#include "kcddb_tests_export.h"
 #include "cdinfo.h"
 #include "config.h"
+#include "discsignature.h"
 
 #include <QString>
 
 namespace KCDDB
 {
-  class CDDB
+  class KCDDB_TESTS_EXPORT CDDB
   {
     public:
       CDDB();
@@ -30,18 +32,21 @@ namespace KCDDB
 
       static uint statusCode( const QString & );
 
-      static CDInfoList cacheFiles(const TrackOffsetList &, const Config& );
+      static CDInfoList cacheFiles(const DiscSignature &, const Config& );
+
+      /**
+       * Reads a cache entry such as "misc/a1107d0a" from the packed store
+       * of @p cacheDir, or from its own file
+       */
+      static bool readCacheEntry(const QString &cacheDir, const QString &entry, QByteArray &data);
 
     protected:
-      QString trackOffsetListToId();
-      QString trackOffsetListToString();
- 
       QString user_;
       QString localHostName_;
 
       bool readOnly_;
 
-      TrackOffsetList trackOffsetList_;
+      DiscSignature signature_;
   };
 }
 
@@ -7,6 +7,7 @@
 */
 
 #include "cddbplookup.h"
+#include "cddbpsessionpool.h"
 #include "logging.h"
 
 #include <QByteArray>
@@ -16,6 +17,7 @@ namespace KCDDB
   CDDBPLookup::CDDBPLookup()
     : Lookup()
     , socket_(nullptr)
+    , port_(0)
   {
 
   }
@@ -48,8 +50,8 @@ namespace KCDDB
   CDDBPLookup::sendQuery()
   {
       QString query = QString::fromLatin1( "cddb query %1 %2" )
-        .arg( trackOffsetListToId() )
-        .arg( trackOffsetListToString() );
+        .arg( signature_.freedbId() )
+        .arg( signature_.queryString() );
 
     writeLine( query );
   }
@@ -83,6 +85,13 @@ namespace KCDDB
     }
   }
 
+    void
+  CDDBPLookup::releaseSession()
+  {
+    CDDBPSessionPool::release( hostName_, port_, socket_ );
+    socket_ = nullptr;
+  }
+
     bool
   CDDBPLookup::parseGreeting( const QString & line )
   {
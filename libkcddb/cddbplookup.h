@@ -29,6 +29,12 @@ namespace KCDDB
 
       void close();
     protected:
+      /**
+       * Gives the connection to the session pool, to be reused by the next
+       * lookup on the same server. Only call it between commands.
+       */
+      void releaseSession();
+
       qint64 writeLine( const QString & );
 
       bool parseGreeting( const QString & );
@@ -38,6 +44,8 @@ namespace KCDDB
         { return QAbstractSocket::ConnectedState == socket_->state(); }
 
       QTcpSocket* socket_;
+      QString hostName_;
+      uint port_;
   };
 }
 
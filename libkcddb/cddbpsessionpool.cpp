@@ -0,0 +1,158 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "cddbpsessionpool.h"
+#include "logging.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QTcpSocket>
+#include <QThread>
+#include <QThreadStorage>
+
+namespace KCDDB
+{
+  namespace
+  {
+    // Servers drop idle connections after a while, don't hand out sessions
+    // that are likely to be gone already
+    const int defaultIdleTimeout = 60 * 1000;
+
+    // Idle sessions kept per server
+    const int maxIdleSessions = 4;
+
+    QAtomicInt s_idleTimeout( defaultIdleTimeout );
+
+    class IdleSession
+    {
+      public:
+        QTcpSocket *socket;
+        QElapsedTimer idle;
+    };
+
+    // The idle sessions of one thread, by server. QThreadStorage deletes
+    // them in that thread when it finishes, as sockets require.
+    class IdleSessions
+    {
+      public:
+        ~IdleSessions()
+        {
+          for ( const QList<IdleSession> &sessions : qAsConst( servers ) )
+          {
+            for ( const IdleSession &session : sessions )
+              delete session.socket;
+          }
+        }
+
+        QHash<QString, QList<IdleSession>> servers;
+    };
+
+    Q_GLOBAL_STATIC(QThreadStorage<IdleSessions *>, s_sessions)
+
+      IdleSessions &
+    idleSessions()
+    {
+      if ( !s_sessions->hasLocalData() )
+        s_sessions->setLocalData( new IdleSessions );
+
+      return *s_sessions->localData();
+    }
+
+      QString
+    serverKey( const QString &hostName, uint port )
+    {
+      return hostName + QLatin1Char( ':' ) + QString::number( port );
+    }
+
+      bool
+    isHealthy( QTcpSocket *socket )
+    {
+      // Lets the socket notice if the server has hung up in the meantime,
+      // also when there's no event loop running
+      socket->waitForReadyRead( 0 );
+
+      // Anything the server sent unasked, such as a timeout notice, means
+      // the session is of no use anymore
+      return QAbstractSocket::ConnectedState == socket->state()
+        && 0 == socket->bytesAvailable();
+    }
+  }
+
+    QTcpSocket *
+  CDDBPSessionPool::take( const QString &hostName, uint port )
+  {
+    QList<IdleSession> &sessions = idleSessions().servers[ serverKey( hostName, port ) ];
+
+    // Sessions are appended when they go idle, so the ones that have
+    // expired are at the front
+    while ( !sessions.isEmpty() && sessions.first().idle.hasExpired( s_idleTimeout.loadRelaxed() ) )
+      delete sessions.takeFirst().socket;
+
+    // The most recently used session is the most likely to still be alive,
+    // the server may have closed the others meanwhile
+    while ( !sessions.isEmpty() )
+    {
+      QTcpSocket *socket = sessions.takeLast().socket;
+
+      if ( isHealthy( socket ) )
+      {
+        qCDebug(LIBKCDDB) << "Reusing CDDBP session with " << hostName;
+        return socket;
+      }
+
+      qCDebug(LIBKCDDB) << "Pooled CDDBP session with " << hostName << " is gone";
+      delete socket;
+    }
+
+    return nullptr;
+  }
+
+    void
+  CDDBPSessionPool::release( const QString &hostName, uint port, QTcpSocket *socket )
+  {
+    socket->disconnect();
+    socket->setParent( nullptr );
+
+    // Only the thread the socket belongs to may use it again
+    if ( socket->thread() != QThread::currentThread() )
+    {
+      socket->deleteLater();
+      return;
+    }
+
+    if ( QAbstractSocket::ConnectedState != socket->state() )
+    {
+      delete socket;
+      return;
+    }
+
+    QList<IdleSession> &sessions = idleSessions().servers[ serverKey( hostName, port ) ];
+
+    if ( sessions.count() >= maxIdleSessions )
+      delete sessions.takeFirst().socket;
+
+    IdleSession session;
+    session.socket = socket;
+    session.idle.start();
+    sessions.append( session );
+  }
+
+    void
+  CDDBPSessionPool::setIdleTimeout( int timeout )
+  {
+    s_idleTimeout.storeRelaxed( qMax( 0, timeout ) );
+  }
+
+    int
+  CDDBPSessionPool::idleTimeout()
+  {
+    return s_idleTimeout.loadRelaxed();
+  }
+}
+
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -0,0 +1,53 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCDDB_CDDBPSESSIONPOOL_H
+#define KCDDB_CDDBPSESSIONPOOL_H
+
+#include "kcddb_tests_export.h"
+
+#include <QString>
+
+class QTcpSocket;
+
+namespace KCDDB
+{
+  /**
+   * Keeps CDDBP connections open between lookups.
+   *
+   * A session is put into the pool after a lookup is done with it, once the
+   * server has greeted it and "cddb hello" and "proto" have been answered,
+   * so the next lookup on the same server only needs its query and read
+   * round trips. A socket can only be used from the thread that created
+   * it, so each thread has a pool of its own, which is closed when the
+   * thread finishes.
+   */
+  class KCDDB_TESTS_EXPORT CDDBPSessionPool
+  {
+    public:
+      /**
+       * @return an idle session with @p hostName:@p port that still looks
+       * alive, or nullptr if there is none. The caller owns the socket.
+       */
+      static QTcpSocket *take( const QString &hostName, uint port );
+
+      /**
+       * Hands @p socket back to the pool. It must be connected, handshaken
+       * and not in the middle of a command. Disconnects all its signals.
+       */
+      static void release( const QString &hostName, uint port, QTcpSocket *socket );
+
+      /**
+       * Sets how long a session may have been idle in ms to be handed out
+       * again, 60000 by default
+       */
+      static void setIdleTimeout( int timeout );
+      static int idleTimeout();
+  };
+}
+
+#endif // KCDDB_CDDBPSESSIONPOOL_H
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -11,185 +11,324 @@
 
 #include "client.h"
 #include "cddb.h"
+#include "cdinfoparser.h"
 #include "logging.h"
 
-#include <KStringHandler>
 #include <QDebug>
 
 #include <QMap>
-#include <QRegularExpression>
 
 namespace KCDDB
 {
-  class InfoBasePrivate {
+  class InfoBasePrivate : public QSharedData {
     public:
       /**
-       * Creates a line in the form NAME=VALUE, and splits it into several
-       * lines if the line gets longer than 256 chars
+       * Writes a line in the form NAME=VALUE in UTF-8, escaping the value,
+       * and splits it into several lines if the line gets longer than 256
+       * bytes. Escape sequences and characters are never split.
        */
-        static QString
-      createLine(const QString& name, const QString& value)
+        static void
+      writeLine(QByteArray& out, const QByteArray& name, const QString& value)
       {
         Q_ASSERT(name.length() < 254);
 
-        int maxLength = 256 - name.length() - 2;
+        const int maxLength = 256 - name.length() - 2;
+        int lineLength = 0;
 
-        QString tmpValue = escape(value);
+        out += name;
+        out += '=';
 
-        QString lines;
-
-        while (tmpValue.length() > maxLength)
+        const QChar *end = value.constData() + value.size();
+        for (const QChar *it = value.constData(); it != end; ++it)
         {
-            lines += QString::fromLatin1("%1=%2\n").arg(name,tmpValue.left(maxLength));
-          tmpValue = tmpValue.mid(maxLength);
+          char piece[4];
+          int length;
+          char32_t c = it->unicode();
+
+          if (c == '\\' || c == '\n' || c == '\t')
+          {
+            piece[0] = '\\';
+            piece[1] = (c == '\\') ? '\\' : (c == '\n') ? 'n' : 't';
+            length = 2;
+          }
+          else if (c < 0x80)
+          {
+            piece[0] = char(c);
+            length = 1;
+          }
+          else if (c < 0x800)
+          {
+            piece[0] = char(0xc0 | (c >> 6));
+            piece[1] = char(0x80 | (c & 0x3f));
+            length = 2;
+          }
+          else if (QChar::isHighSurrogate(c) && it + 1 != end && it[1].isLowSurrogate())
+          {
+            c = QChar::surrogateToUcs4(char16_t(c), it[1].unicode());
+            ++it;
+            piece[0] = char(0xf0 | (c >> 18));
+            piece[1] = char(0x80 | ((c >> 12) & 0x3f));
+            piece[2] = char(0x80 | ((c >> 6) & 0x3f));
+            piece[3] = char(0x80 | (c & 0x3f));
+            length = 4;
+          }
+          else
+          {
+            // A lone surrogate can't be encoded
+            if (QChar::isSurrogate(c))
+              c = QChar::ReplacementCharacter;
+            piece[0] = char(0xe0 | (c >> 12));
+            piece[1] = char(0x80 | ((c >> 6) & 0x3f));
+            piece[2] = char(0x80 | (c & 0x3f));
+            length = 3;
+          }
+
+          if (lineLength + length > maxLength && lineLength > 0)
+          {
+            out += '\n';
+            out += name;
+            out += '=';
+            lineLength = 0;
+          }
+
+          out.append(piece, length);
+          lineLength += length;
         }
 
-        lines += QString::fromLatin1("%1=%2\n").arg(name,tmpValue);
-
-        return lines;
+        out += '\n';
       }
 
       /**
-       * escape's string for CDDB processing
+       * Writes the custom data of a track, as T<NAME>_<track number> lines
        */
-        static QString
-      escape( const QString &value )
+        void
+      writeTrackData(QByteArray& out) const
       {
-        QString s = value;
-        s.replace( QLatin1String( "\\" ), QLatin1String( "\\\\" ) );
-        s.replace( QLatin1String( "\n" ), QLatin1String( "\\n" ) );
-        s.replace( QLatin1String( "\t" ), QLatin1String( "\\t" ) );
+        bool ok;
+        const QByteArray track = QByteArray::number(get(TrackNumberField).toInt(&ok));
+        if(!ok)
+	  qCDebug(LIBKCDDB) << "Warning toString() on a track that doesn't have track number assigned.";
 
-        return s;
+        forEach([&out, &track](const QString &key, const QVariant &value) {
+          if(key != QLatin1String( "COMMENT" ) && key != QLatin1String( "TITLE" ) && key != QLatin1String( "ARTIST" ) && key != QLatin1String( "TRACKNUMBER" )) {
+            writeLine(out, 'T' + key.toUtf8() + '_' + track, value.toString());
+          }
+        });
       }
 
       /**
-       * fixes an escaped string that has been CDDB processed
+       * The fields every entry may have, in the order of their names, so
+       * they sort the same way as the keys of custom data
        */
-        static QString
-      unescape( const QString &value )
+      enum Field
       {
-        QString s = value;
-
-        s.replace( QLatin1String( "\\n" ), QLatin1String( "\n" ) );
-        s.replace( QLatin1String( "\\t" ), QLatin1String( "\t" ) );
-        s.replace( QLatin1String( "\\\\" ), QLatin1String( "\\" ) );
+        ArtistField,
+        CategoryField,
+        CommentField,
+        DiscIdField,
+        GenreField,
+        LengthField,
+        PlayOrderField,
+        RevisionField,
+        SourceField,
+        TitleField,
+        TrackNumberField,
+        YearField,
+        FieldCount
+      };
+
+        static QLatin1String
+      fieldName(int field)
+      {
+        static const char * const names[FieldCount] = {
+          "ARTIST", "CATEGORY", "COMMENT", "DISCID", "GENRE", "LENGTH",
+          "PLAYORDER", "REVISION", "SOURCE", "TITLE", "TRACKNUMBER", "YEAR"
+        };
 
-        return s;
+        return QLatin1String(names[field]);
       }
 
-        QVariant
-      get(const QString& type)
+      /**
+       * @return the field called @p type, ignoring case, or -1 if it's
+       * custom data
+       */
+        static int
+      field(const QString& type)
       {
-        return data[type.toUpper()];
+        for (int f = 0; f < FieldCount; ++f)
+        {
+          if (type.compare(fieldName(f), Qt::CaseInsensitive) == 0)
+            return f;
+        }
+
+        return -1;
       }
-        QVariant
-      get(Type type)
+
+        static Field
+      field(Type type)
       {
         switch(type){
           case(Title):
-            return get(QLatin1String( "title" ));
+            return TitleField;
           case(Comment):
-            return get(QLatin1String( "comment" ));
+            return CommentField;
           case(Artist):
-            return get(QLatin1String( "artist" ));
+            return ArtistField;
           case(Genre):
-            return get(QLatin1String( "genre" ));
+            return GenreField;
           case(Year):
-            return get(QLatin1String( "year" ));
+            return YearField;
           case(Length):
-            return get(QLatin1String( "length" ));
+            return LengthField;
           case(Category):
-            return get(QLatin1String( "category" ));
+            return CategoryField;
         }
-        return QVariant();
+
+        Q_ASSERT(false);
+        return TitleField;
+      }
+
+        QVariant
+      get(const QString& type) const
+      {
+        const int f = field(type);
+        if (f != -1)
+          return fields[f];
+
+        // Custom data is stored under the upper case key
+        const QString key = type.toUpper();
+        const int upperField = field(key);
+        if (upperField != -1)
+          return fields[upperField];
+
+        return customData.value(key);
+      }
+        QVariant
+      get(Type type) const
+      {
+        return fields[field(type)];
+      }
+        QVariant
+      get(Field f) const
+      {
+        return fields[f];
       }
 
         void
       set(const QString& type, const QVariant &d)
       {
         //qDebug() << "set: " << type << ", " << d.toString();
-        if(type.contains(QRegularExpression( QLatin1String( "^T.*_.*$" )) )){
+        if(type.startsWith(QLatin1Char( 'T' )) && type.indexOf(QLatin1Char( '_' ), 1) != -1){
 		  qCDebug(LIBKCDDB) << "Error: custom cdinfo::set data can not start with T and contain a _";
           return;
         }
-        if(type.toUpper() == QLatin1String( "DTITLE" )){
+
+        const int f = field(type);
+        if (f != -1)
+        {
+          set(f, d);
+          return;
+        }
+
+        const QString key = type.toUpper();
+        if(key == QLatin1String( "DTITLE" )){
 		  qCDebug(LIBKCDDB) << "Error: type: DTITLE is reserved and can not be set.";
           return;
         }
 
-        data[type.toUpper()] = d;
+        const int upperField = field(key);
+        if (upperField != -1)
+          set(upperField, d);
+        else
+          customData[key] = d;
       }
         void
       set(Type type, const QVariant &d)
       {
-        switch(type)
-        {
-          case(Title):
-            set(QLatin1String( "title" ), d);
-            return;
-          case(Comment):
-            set(QLatin1String( "comment" ), d);
-            return;
-          case(Artist):
-            set(QLatin1String( "artist" ), d);
-            return;
-          case(Genre):
-            set(QLatin1String( "genre" ), d);
-            return;
-          case(Year):
-            set(QLatin1String( "year" ), d);
-            return;
-          case(Length):
-            set(QLatin1String( "length" ), d);
-            return;
-          case(Category):
-            set(QLatin1String( "category" ), d);
-            return;
-        }
-
-        Q_ASSERT(false);
+        set(field(type), d);
+      }
+        void
+      set(int f, const QVariant &d)
+      {
+        fields[f] = d;
+        present |= 1u << f;
       }
 
-      // Appends text to data instead of overwriting it
         void
-      append(const QString& type, const QString& text)
+      clear()
       {
-        set(type, get(type).toString().append(text));
+        for (QVariant &value : fields)
+          value = QVariant();
+        present = 0;
+        customData.clear();
       }
+
+        bool
+      operator==(const InfoBasePrivate& other) const
+      {
+        if (present != other.present || customData != other.customData)
+          return false;
+
+        for (int f = 0; f < FieldCount; ++f)
+        {
+          if ((present & (1u << f)) && fields[f] != other.fields[f])
+            return false;
+        }
+
+        return true;
+      }
+
+      /**
+       * Calls @p function with the upper case key and the value of
+       * everything that has been set, ordered by key
+       */
+      template<typename Function>
         void
-      append(Type type, const QString& text)
+      forEach(Function function) const
       {
-        set(type, get(type).toString().append(text));
+        auto it = customData.constBegin();
+
+        for (int f = 0; f < FieldCount; ++f)
+        {
+          if (!(present & (1u << f)))
+            continue;
+
+          const QLatin1String name = fieldName(f);
+          for (; it != customData.constEnd() && it.key() < name; ++it)
+            function(it.key(), it.value());
+
+          function(QString(name), fields[f]);
+        }
+
+        for (; it != customData.constEnd(); ++it)
+          function(it.key(), it.value());
       }
 
-      QMap<QString, QVariant> data;
+      QVariant fields[FieldCount];
+      // Which of the fields have been set
+      quint32 present = 0;
+      QMap<QString, QVariant> customData;
   } ;
 
   class TrackInfoPrivate : public InfoBasePrivate {
   };
 
   TrackInfo::TrackInfo()
+    : d(new TrackInfoPrivate())
   {
-    d = new TrackInfoPrivate();
   }
 
-  TrackInfo::TrackInfo(const TrackInfo& clone)
-      : d(new TrackInfoPrivate)
-  {
-    d->data = clone.d->data;
-  }
+  TrackInfo::TrackInfo(const TrackInfo& clone) = default;
+
+  TrackInfo::TrackInfo(TrackInfo&& other) noexcept = default;
 
   TrackInfo::~TrackInfo()
   {
-     delete d;
   }
 
-  TrackInfo& TrackInfo::operator=(const TrackInfo& clone)
-  {
-    d->data = clone.d->data;
-    return *this;
-  }
+  TrackInfo& TrackInfo::operator=(const TrackInfo& clone) = default;
+
+  TrackInfo& TrackInfo::operator=(TrackInfo&& other) noexcept = default;
 
   QVariant TrackInfo::get(Type type) const {
     return d->get(type);
@@ -208,33 +347,23 @@ namespace KCDDB
   }
 
   void TrackInfo::clear(){
-    d->data.clear();
+    d->clear();
   }
 
   QString TrackInfo::toString() const {
-    QString out;
-    bool ok;
-    int track = get(QLatin1String( "tracknumber" )).toInt(&ok);
-    if(!ok)
-	  qCDebug(LIBKCDDB) << "Warning toString() on a track that doesn't have track number assigned.";
-    QMap<QString, QVariant>::const_iterator i = d->data.constBegin();
-    while (i != d->data.constEnd()) {
-        if(i.key() != QLatin1String( "COMMENT" ) && i.key() != QLatin1String( "TITLE" ) && i.key() != QLatin1String( "ARTIST" ) && i.key() != QLatin1String( "TRACKNUMBER" )) {
-            out += d->createLine(QString::fromLatin1("T%1_%2").arg(i.key()).arg(track),i.value().toString());
-        }
-        ++i;
-    }
-    return out;
+    QByteArray out;
+    d->writeTrackData(out);
+    return QString::fromUtf8(out);
   }
 
     bool TrackInfo::operator==( const TrackInfo& other ) const
     {
-        return d->data == other.d->data;
+        return d == other.d || *d == *other.d;
     }
 
     bool TrackInfo::operator!=( const TrackInfo& other ) const
     {
-        return d->data != other.d->data;
+        return !(*this == other);
     }
 
   class CDInfoPrivate : public InfoBasePrivate {
@@ -248,29 +377,28 @@ namespace KCDDB
     set(QLatin1String( "revision" ), 0);
   }
 
-  CDInfo::CDInfo(const CDInfo& clone)
-    : d(new CDInfoPrivate())
-  {
-    d->data = clone.d->data;
-    d->trackInfoList = clone.d->trackInfoList;
-  }
+  CDInfo::CDInfo(const CDInfo& clone) = default;
+
+  CDInfo::CDInfo(CDInfo&& other) noexcept = default;
 
   CDInfo::~CDInfo()
   {
-    delete d;
   }
 
-  CDInfo& CDInfo::operator=(const CDInfo& clone)
-  {
-    d->trackInfoList = clone.d->trackInfoList;
-    d->data = clone.d->data;
-    return *this;
-  }
+  CDInfo& CDInfo::operator=(const CDInfo& clone) = default;
+
+  CDInfo& CDInfo::operator=(CDInfo&& other) noexcept = default;
 
     bool
   CDInfo::load(const QString & string)
   {
-    return load(string.split(QLatin1Char( '\n' ),Qt::SkipEmptyParts));
+    clear();
+
+    CDInfoParser parser(*this);
+    parser.parse(string);
+    parser.finish();
+
+    return true;
   }
 
     bool
@@ -278,130 +406,22 @@ namespace KCDDB
   {
     clear();
 
-    // We'll append to this until we've seen all the lines, then parse it after.
-    QString dtitle;
-
-    QStringList::ConstIterator it = lineList.begin();
-
-    const static QRegularExpression rev(QLatin1String( "# Revision: (\\d+)" ));
-    const static QRegularExpression eol(QLatin1String( "[\r\n]" ));
-
-    while ( it != lineList.end() )
-    {
-      QString line(*it);
-      line.remove(eol);
-      ++it;
-
-      if (const auto revMatch = rev.match(line); revMatch.hasMatch())
-      {
-        set(QLatin1String( "revision" ), revMatch.captured(1).toUInt());
-        continue;
-      }
-
-      QStringList tokenList = KStringHandler::perlSplit(QLatin1Char( '=' ), line, 2);
-
-      if (2 != tokenList.count())
-      {
-        continue;
-      }
-
-      QString key = tokenList[0].trimmed();
-      QString value = d->unescape ( tokenList[1] );
-
-      if ( QLatin1String( "DTITLE" ) == key )
-      {
-        dtitle += value;
-      }
-      else if ( key.startsWith(QLatin1String( "TTITLE" )) )
-      {
-        uint trackNumber = key.mid(6).toUInt();
-
-        TrackInfo& ti = track(trackNumber);
-        ti.set(Title, ti.get(Title).toString().append(value));
-      }
+    CDInfoParser parser(*this);
+    for (const QString &line : lineList)
+      parser.parseLine(line);
+    parser.finish();
 
-      else if ( QLatin1String( "EXTD" ) == key )
-      {
-        d->append(Comment, value);
-      }
-      else if ( QLatin1String( "DGENRE" ) == key )
-      {
-        d->append(Genre, value);
-      }
-      else if ( QLatin1String( "DYEAR" ) == key )
-      {
-        set(Year, value);
-      }
-      else if ( key.startsWith(QLatin1String( "EXTT" )) )
-      {
-        uint trackNumber = key.mid( 4 ).toUInt();
-
-        checkTrack( trackNumber );
-
-        QString extt = track(trackNumber).get(Comment).toString();
-        track(trackNumber).set(Comment, QVariant(extt + value));
-      }
-      else if ( key.startsWith(QLatin1String( "T" )) )
-      {
-        // Custom Track data
-        uint trackNumber = key.mid( key.indexOf(QLatin1Char( '_' ))+1 ).toUInt();
-        checkTrack( trackNumber );
-
-        QRegularExpression data(QString::fromLatin1("^T.*_%1$").arg(trackNumber));
-        if  ( key.contains( data ) )
-        {
-          QString k = key.mid(1, key.indexOf(QLatin1Char( '_' ))-1);
-          TrackInfo& ti = track(trackNumber);
-          ti.set( k, ti.get(k).toString().append(value) );
-        }
-      }
-      else
-      {
-        // Custom Disk data
-        d->append( key, value );
-      }
-    }
-
-    int slashPos = dtitle.indexOf(QLatin1String( " / " ));
-
-    if (-1 == slashPos)
-    {
-      // Use string for title _and_ artist.
-      set(Artist, dtitle);
-      set(Title, dtitle);
-    }
-    else
-    {
-      set(Artist, dtitle.left(slashPos).trimmed());
-      set(Title, dtitle.mid(slashPos + 3).trimmed());
-    }
-
-    bool isSampler = true;
-    for (TrackInfoList::Iterator it = d->trackInfoList.begin(); it != d->trackInfoList.end(); ++it)
-    {
-      if (!(*it).get(Title).toString().contains(QLatin1String( " / " )))
-      {
-        isSampler = false;
-      }
-    }
-    for (TrackInfoList::Iterator it = d->trackInfoList.begin(); it != d->trackInfoList.end(); ++it)
-    {
-      if (isSampler)
-      {
-        int delimiter = (*it).get(Title).toString().indexOf(QLatin1String( " / " ));
-        (*it).set(Artist, (*it).get(Title).toString().left(delimiter));
-        (*it).set(Title, (*it).get(Title).toString().mid(delimiter + 3));
-      }
-      else
-      {
-        (*it).set(Artist, get(Artist));
-      }
-    }
+    return true;
+  }
 
-    if ( get(Genre).toString().isEmpty() )
-      set(Genre, QLatin1String( "Unknown" ));
+    bool
+  CDInfo::loadUtf8(const QByteArray & data)
+  {
+    clear();
 
-	qCDebug(LIBKCDDB) << "Loaded CDInfo for " << get(QLatin1String( "discid" )).toString();
+    CDInfoParser parser(*this);
+    parser.parse(data);
+    parser.finish();
 
     return true;
   }
@@ -409,28 +429,33 @@ namespace KCDDB
     QString
   CDInfo::toString(bool submit) const
   {
-    QString s;
+    return QString::fromUtf8(toUtf8(submit));
+  }
+
+    QByteArray
+  CDInfo::toUtf8(bool submit) const
+  {
+    QByteArray s;
 
     if (get(QLatin1String( "revision" )) != 0)
-      s += QLatin1String( "# Revision: " ) + get(QLatin1String( "revision" )).toString() + QLatin1Char( '\n' );
+      s += "# Revision: " + get(QLatin1String( "revision" )).toString().toUtf8() + '\n';
 
     // If we are submitting make it a fully compliant CDDB entry
     if (submit)
     {
-      s += QLatin1String( "#\n" );
-      s += QString::fromLatin1("# Submitted via: %1 %2\n").arg(CDDB::clientName(),
-        CDDB::clientVersion());
+      s += "#\n";
+      s += "# Submitted via: " + CDDB::clientName().toUtf8() + ' ' + CDDB::clientVersion().toUtf8() + '\n';
     }
 
-    s += d->createLine(QLatin1String( "DISCID" ), get(QLatin1String( "discid" )).toString() );
+    d->writeLine(s, "DISCID", get(QLatin1String( "discid" )).toString() );
     QString artist = get(Artist).toString();
-    s += d->createLine(QLatin1String( "DTITLE" ), artist + QLatin1String( " / " ) + get(Title).toString() );
+    d->writeLine(s, "DTITLE", artist + QLatin1String( " / " ) + get(Title).toString() );
     int year = get(Year).toInt();
-    s += QLatin1String( "DYEAR=" ) + (0 == year ? QString() : QString::number(year)) + QLatin1Char( '\n' );	//krazy:exclude=nullstrassign for old broken gcc
+    s += "DYEAR=" + (0 == year ? QByteArray() : QByteArray::number(year)) + '\n';
     if (get(Genre) == QLatin1String( "Unknown" ))
-      s += d->createLine(QLatin1String( "DGENRE" ), QString());
+      d->writeLine(s, "DGENRE", QString());
     else
-      s += d->createLine(QLatin1String( "DGENRE" ),get(Genre).toString());
+      d->writeLine(s, "DGENRE", get(Genre).toString());
 
     bool isSampler = false;
     for (int i = 0; i < d->trackInfoList.count(); ++i){
@@ -443,59 +468,50 @@ namespace KCDDB
     }
 
     for (int i = 0; i < d->trackInfoList.count(); ++i){
+      const QByteArray key = "TTITLE" + QByteArray::number(i);
       QString trackTitle = d->trackInfoList[i].get(Title).toString();
       QString trackArtist = d->trackInfoList[i].get(Artist).toString();
       if (isSampler)
       {
         if (trackArtist.isEmpty())
-          s += d->createLine(QString::fromLatin1("TTITLE%1").arg(i), QString::fromLatin1("%1 / %2").arg(artist).arg(trackTitle));
+          d->writeLine(s, key, artist + QLatin1String( " / " ) + trackTitle);
         else
-          s += d->createLine(QString::fromLatin1("TTITLE%1").arg(i), QString::fromLatin1("%1 / %2").arg(trackArtist).arg(trackTitle));
+          d->writeLine(s, key, trackArtist + QLatin1String( " / " ) + trackTitle);
       }
       else
       {
-          s += d->createLine(QString::fromLatin1("TTITLE%1").arg(i), trackTitle);
+          d->writeLine(s, key, trackTitle);
       }
     }
 
-    s += d->createLine(QLatin1String("EXTD"), get(Comment).toString());
+    d->writeLine(s, "EXTD", get(Comment).toString());
 
     for (int i = 0; i < d->trackInfoList.count(); ++i)
-        s += d->createLine(QString::fromLatin1("EXTT%1").arg(i), d->trackInfoList[i].get(Comment).toString());
+        d->writeLine(s, "EXTT" + QByteArray::number(i), d->trackInfoList[i].get(Comment).toString());
 
     if (submit)
     {
-      s += d->createLine(QLatin1String( "PLAYORDER" ), QString());
+      d->writeLine(s, "PLAYORDER", QString());
       return s;
     }
 
-    s += d->createLine(QLatin1String( "PLAYORDER" ), get(QLatin1String( "playorder" )).toString() );
+    d->writeLine(s, "PLAYORDER", get(QLatin1String( "playorder" )).toString() );
 
     // Custom track data
     for (int i = 0; i < d->trackInfoList.count(); ++i)
-      s += d->trackInfoList[i].toString();
-
-    QStringList cddbKeywords;
-    cddbKeywords
-      << QLatin1String( "DISCID" )
-      << QLatin1String( "ARTIST" )
-      << QLatin1String( "TITLE" )
-      << QLatin1String( "COMMENT" )
-      << QLatin1String( "YEAR" )
-      << QLatin1String( "GENRE" )
-      << QLatin1String( "PLAYORDER" )
-      << QLatin1String( "CATEGORY" )
-      << QLatin1String( "REVISION" );
+      d->trackInfoList[i].d->writeTrackData(s);
 
     // Custom disc data
-    QMap<QString, QVariant>::const_iterator i = d->data.constBegin();
-    while (i != d->data.constEnd()){
-      if (!cddbKeywords.contains(i.key()) && i.key() != QLatin1String( "SOURCE" ))
+    d->forEach([&s](const QString &key, const QVariant &value) {
+      if (key != QLatin1String( "DISCID" ) && key != QLatin1String( "ARTIST" )
+          && key != QLatin1String( "TITLE" ) && key != QLatin1String( "COMMENT" )
+          && key != QLatin1String( "YEAR" ) && key != QLatin1String( "GENRE" )
+          && key != QLatin1String( "PLAYORDER" ) && key != QLatin1String( "CATEGORY" )
+          && key != QLatin1String( "REVISION" ) && key != QLatin1String( "SOURCE" ))
       {
-        s+= d->createLine(i.key(), i.value().toString());
+        InfoBasePrivate::writeLine(s, key.toUtf8(), value.toString());
       }
-      ++i;
-    }
+    });
 
     return s;
   }
@@ -530,7 +546,7 @@ namespace KCDDB
     void
   CDInfo::clear()
   {
-    d->data.clear();
+    d->clear();
     d->trackInfoList.clear();
   }
 
@@ -574,14 +590,14 @@ namespace KCDDB
 
     bool CDInfo::operator==( const CDInfo& other ) const
     {
-        return(  d->data == other.d->data &&
-                 d->trackInfoList == other.d->trackInfoList );
+        return(  d == other.d ||
+                 ( *d == *other.d &&
+                   d->trackInfoList == other.d->trackInfoList ) );
     }
 
     bool CDInfo::operator!=( const CDInfo& other ) const
     {
-        return(  d->data != other.d->data ||
-                 d->trackInfoList != other.d->trackInfoList );
+        return !(*this == other);
     }
 }
 
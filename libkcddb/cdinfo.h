@@ -10,6 +10,7 @@
 #define KCDDB_CDINFO_H
 
 #include "kcddb_export.h"
+#include <QSharedDataPointer>
 #include <QStringList>
 #include <QVariant>
 
@@ -36,8 +37,13 @@ namespace KCDDB
                   reggae, rock, soundtrack */
   };
 
+  class TrackInfoPrivate;
+  class CDInfoPrivate;
+
   /**
    * Information about a specific track in a cd.
+   *
+   * TrackInfo is implicitly shared, copies are cheap.
    */
   class KCDDB_EXPORT TrackInfo
   {
@@ -46,7 +52,9 @@ namespace KCDDB
       TrackInfo();
       virtual ~TrackInfo();
       TrackInfo(const TrackInfo& clone);
+      TrackInfo(TrackInfo&& other) noexcept;
       TrackInfo& operator=(const TrackInfo& clone);
+      TrackInfo& operator=(TrackInfo&& other) noexcept;
 
       bool operator==(const TrackInfo&) const;
       bool operator!=(const TrackInfo&) const;
@@ -87,7 +95,9 @@ namespace KCDDB
       void clear();
 
     private:
-      class TrackInfoPrivate *d;
+      friend class CDInfo;
+
+      QSharedDataPointer<TrackInfoPrivate> d;
 
   };
 
@@ -96,6 +106,8 @@ namespace KCDDB
   /**
    * Information about a CD
    *
+   * CDInfo is implicitly shared, copies are cheap.
+   *
    * Typically CDInfo is obtained from the client such as:
    * <code>KCDDB::Client *cddb = new KCDDB::Client();
    * cddb->lookup(discSignature);
@@ -108,7 +120,9 @@ namespace KCDDB
       virtual ~CDInfo();
 
       CDInfo(const CDInfo& clone);
+      CDInfo(CDInfo&& other) noexcept;
       CDInfo& operator=(const CDInfo& clone);
+      CDInfo& operator=(CDInfo&& other) noexcept;
 
       bool operator==(const CDInfo&) const;
       bool operator!=(const CDInfo&) const;
@@ -123,6 +137,12 @@ namespace KCDDB
        * @return true if successful
        */
       bool load(const QStringList &stringList);
+      /**
+       * Load CDInfo from UTF-8 encoded data that is CDDB compatible,
+       * such as a server response or a cache file
+       * @return true if successful
+       */
+      bool loadUtf8(const QByteArray &data);
 
       /**
        * Clear all information, setting this to invalid
@@ -141,6 +161,13 @@ namespace KCDDB
        */
       QString toString(bool submit=false) const;
 
+      /**
+       * Same as toString(), but writes the UTF-8 encoded entry directly
+       * @param submit If submit is true only returns CDDB compatible information
+       * @return the CD's information, as stored in the cache and sent to servers
+       */
+      QByteArray toUtf8(bool submit=false) const;
+
       /**
        * Get data for type that has been assigned to this disc.
        * @p type is case insensitive.
@@ -189,7 +216,7 @@ namespace KCDDB
       void checkTrack( int trackNumber );
 
     private:
-      class CDInfoPrivate * const d;
+      QSharedDataPointer<CDInfoPrivate> d;
   };
 
   typedef QList<CDInfo> CDInfoList;
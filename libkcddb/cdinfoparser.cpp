@@ -0,0 +1,447 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "cdinfoparser.h"
+#include "cdinfo.h"
+#include "logging.h"
+
+#include <QVarLengthArray>
+
+#include <algorithm>
+#include <limits>
+
+namespace KCDDB
+{
+  namespace
+  {
+      inline char16_t
+    unit( QChar c )
+    {
+      return c.unicode();
+    }
+
+      inline char16_t
+    unit( char c )
+    {
+      return uchar( c );
+    }
+
+      inline bool
+    isSpace( QChar c )
+    {
+      return c.isSpace();
+    }
+
+      inline bool
+    isSpace( char c )
+    {
+      // What QString::trimmed() would strip, as far as it can be found in
+      // single bytes of UTF-8
+      return c == ' ' || ( c >= '\t' && c <= '\r' );
+    }
+
+      inline bool
+    isDigit( char16_t c )
+    {
+      return c >= '0' && c <= '9';
+    }
+
+      inline QString
+    toQString( const QChar *begin, const QChar *end )
+    {
+      return QString( begin, end - begin );
+    }
+
+      inline QString
+    toQString( const char *begin, const char *end )
+    {
+      return QString::fromUtf8( begin, end - begin );
+    }
+
+    template<typename Char>
+      bool
+    startsWith( const Char *begin, const Char *end, const char *prefix )
+    {
+      for ( ; *prefix; ++prefix, ++begin )
+      {
+        if ( begin == end || unit( *begin ) != uchar( *prefix ) )
+          return false;
+      }
+
+      return true;
+    }
+
+    template<typename Char>
+      bool
+    equals( const Char *begin, const Char *end, const char *s )
+    {
+      return end - begin == int( qstrlen( s ) ) && startsWith( begin, end, s );
+    }
+
+    template<typename Char>
+      const Char *
+    find( const Char *begin, const Char *end, const char *needle )
+    {
+      const int length = int( qstrlen( needle ) );
+
+      for ( ; end - begin >= length; ++begin )
+      {
+        if ( startsWith( begin, end, needle ) )
+          return begin;
+      }
+
+      return end;
+    }
+
+    /**
+     * Parses a number the way QString::toUInt() does, returning 0 for
+     * anything that isn't a number or is larger than @p max
+     */
+    template<typename Char>
+      quint64
+    parseNumber( const Char *begin, const Char *end, quint64 max )
+    {
+      while ( begin != end && isSpace( *begin ) )
+        ++begin;
+      while ( end != begin && isSpace( *( end - 1 ) ) )
+        --end;
+
+      if ( begin != end && unit( *begin ) == '+' )
+        ++begin;
+
+      if ( begin == end )
+        return 0;
+
+      quint64 number = 0;
+      for ( ; begin != end; ++begin )
+      {
+        if ( !isDigit( unit( *begin ) ) )
+          return 0;
+
+        number = number * 10 + ( unit( *begin ) - '0' );
+        if ( number > max )
+          return 0;
+      }
+
+      return number;
+    }
+
+    template<typename Char>
+      int
+    parseTrackNumber( const Char *begin, const Char *end )
+    {
+      return int( parseNumber( begin, end, std::numeric_limits<int>::max() ) );
+    }
+
+    /**
+     * @return true if @p begin .. @p end ends with "_<number>" and has at
+     * least one character before that
+     */
+    template<typename Char>
+      bool
+    endsWithTrackNumber( const Char *begin, const Char *end, int number )
+    {
+      char suffix[ 16 ];
+      const int length = qsnprintf( suffix, sizeof( suffix ), "_%d", number );
+
+      return end - begin > length && equals( end - length, end, suffix );
+    }
+
+    /**
+     * Undoes the escaping of \\n, \\t and \\\\ in a single pass, dropping
+     * any line terminators on the way
+     */
+    template<typename Char>
+      QString
+    unescape( const Char *begin, const Char *end )
+    {
+      const Char *special = std::find_if( begin, end, []( Char c ) {
+        return unit( c ) == '\\' || unit( c ) == '\r' || unit( c ) == '\n';
+      });
+
+      // Most values have nothing to unescape
+      if ( special == end )
+        return toQString( begin, end );
+
+      QVarLengthArray<Char, 256> buffer;
+      buffer.append( begin, special - begin );
+
+      for ( const Char *it = special; it != end; ++it )
+      {
+        const char16_t c = unit( *it );
+
+        if ( c == '\r' || c == '\n' )
+          continue;
+
+        if ( c == '\\' && it + 1 != end )
+        {
+          const char16_t next = unit( *( it + 1 ) );
+          if ( next == 'n' || next == 't' || next == '\\' )
+          {
+            buffer.append( next == 'n' ? Char( u'\n' ) : next == 't' ? Char( u'\t' ) : Char( u'\\' ) );
+            ++it;
+            continue;
+          }
+        }
+
+        buffer.append( *it );
+      }
+
+      return toQString( buffer.constData(), buffer.constData() + buffer.size() );
+    }
+  }
+
+  CDInfoParser::CDInfoParser( CDInfo &info )
+    : info_( info ), finished_( false )
+  {
+  }
+
+    void
+  CDInfoParser::parseLine( QStringView line )
+  {
+    parseLine( line.begin(), line.end() );
+  }
+
+    void
+  CDInfoParser::parseLine( const QByteArray &line )
+  {
+    parseLine( line.constBegin(), line.constEnd() );
+  }
+
+    void
+  CDInfoParser::parse( QStringView text )
+  {
+    parse( text.begin(), text.end() );
+  }
+
+    void
+  CDInfoParser::parse( const QByteArray &text )
+  {
+    parse( text.constBegin(), text.constEnd() );
+  }
+
+  template<typename Char>
+    void
+  CDInfoParser::parse( const Char *begin, const Char *end )
+  {
+    const Char *it = begin;
+
+    while ( it != end )
+    {
+      const Char *eol = std::find_if( it, end, []( Char c ) { return unit( c ) == '\n'; } );
+      if ( eol != it )
+        parseLine( it, eol );
+
+      it = ( eol == end ) ? end : eol + 1;
+    }
+  }
+
+  template<typename Char>
+    void
+  CDInfoParser::parseLine( const Char *begin, const Char *end )
+  {
+    // The revision comment counts wherever it appears in the line
+    for ( const Char *revision = find( begin, end, "# Revision: " ); revision != end;
+        revision = find( revision + 1, end, "# Revision: " ) )
+    {
+      const Char *digits = revision + 12;
+      const Char *digitsEnd = std::find_if( digits, end, []( Char c ) { return !isDigit( unit( c ) ); } );
+
+      if ( digitsEnd != digits )
+      {
+        info_.set( QLatin1String( "revision" ), uint( parseNumber( digits, digitsEnd, std::numeric_limits<uint>::max() ) ) );
+        return;
+      }
+    }
+
+    // KEY=value, where leading '=' are skipped and an empty value means there's nothing to set
+    while ( begin != end && unit( *begin ) == '=' )
+      ++begin;
+
+    const Char *separator = std::find_if( begin, end, []( Char c ) { return unit( c ) == '='; } );
+    if ( separator == end )
+      return;
+
+    const QString value = unescape( separator + 1, end );
+    if ( value.isEmpty() )
+      return;
+
+    const Char *key = begin;
+    const Char *keyEnd = separator;
+    while ( key != keyEnd && isSpace( *key ) )
+      ++key;
+    while ( keyEnd != key && isSpace( *( keyEnd - 1 ) ) )
+      --keyEnd;
+
+    if ( equals( key, keyEnd, "DTITLE" ) )
+    {
+      dtitle_ += value;
+    }
+    else if ( startsWith( key, keyEnd, "TTITLE" ) )
+    {
+      TrackInfo &ti = info_.track( parseTrackNumber( key + 6, keyEnd ) );
+      ti.set( Title, ti.get( Title ).toString().append( value ) );
+    }
+    else if ( equals( key, keyEnd, "EXTD" ) )
+    {
+      info_.set( Comment, info_.get( Comment ).toString().append( value ) );
+    }
+    else if ( equals( key, keyEnd, "DGENRE" ) )
+    {
+      info_.set( Genre, info_.get( Genre ).toString().append( value ) );
+    }
+    else if ( equals( key, keyEnd, "DYEAR" ) )
+    {
+      info_.set( Year, value );
+    }
+    else if ( startsWith( key, keyEnd, "EXTT" ) )
+    {
+      TrackInfo &ti = info_.track( parseTrackNumber( key + 4, keyEnd ) );
+      ti.set( Comment, ti.get( Comment ).toString().append( value ) );
+    }
+    else if ( startsWith( key, keyEnd, "T" ) )
+    {
+      // Custom track data, T<name>_<track number>
+      const Char *underscore = std::find_if( key, keyEnd, []( Char c ) { return unit( c ) == '_'; } );
+      const int trackNumber = ( underscore == keyEnd ) ? 0 : parseTrackNumber( underscore + 1, keyEnd );
+
+      TrackInfo &ti = info_.track( trackNumber );
+
+      if ( underscore != keyEnd && endsWithTrackNumber( key, keyEnd, trackNumber ) )
+      {
+        const QString name = toQString( key + 1, underscore );
+        ti.set( name, ti.get( name ).toString().append( value ) );
+      }
+    }
+    else
+    {
+      // Custom disc data
+      const QString name = toQString( key, keyEnd );
+      info_.set( name, info_.get( name ).toString().append( value ) );
+    }
+  }
+
+    int
+  CDInfoParser::feed( const QByteArray &chunk )
+  {
+    if ( finished_ )
+      return 0;
+
+    const char *begin = chunk.constData();
+    const char *end = begin + chunk.size();
+
+    for ( const char *it = begin; it != end; )
+    {
+      const char *eol = std::find( it, end, '\n' );
+
+      if ( eol == end )
+      {
+        pending_.append( it, end - it );
+        break;
+      }
+
+      // Only copy lines that were split between chunks
+      const char *line = it;
+      const char *lineEnd = eol;
+      if ( !pending_.isEmpty() )
+      {
+        pending_.append( it, eol - it );
+        line = pending_.constData();
+        lineEnd = line + pending_.size();
+      }
+
+      it = eol + 1;
+
+      if ( line != lineEnd && *line == '.' )
+      {
+        pending_.clear();
+        finish();
+        return int( it - begin );
+      }
+
+      parseLine( line, lineEnd );
+      pending_.clear();
+    }
+
+    return int( chunk.size() );
+  }
+
+    bool
+  CDInfoParser::isFinished() const
+  {
+    return finished_;
+  }
+
+    void
+  CDInfoParser::reset()
+  {
+    info_.clear();
+    dtitle_.clear();
+    pending_.clear();
+    finished_ = false;
+  }
+
+    void
+  CDInfoParser::finish()
+  {
+    if ( finished_ )
+      return;
+
+    finished_ = true;
+
+    if ( !pending_.isEmpty() && !pending_.startsWith( '.' ) )
+      parseLine( pending_.constBegin(), pending_.constEnd() );
+    pending_.clear();
+
+    int slashPos = dtitle_.indexOf(QLatin1String( " / " ));
+
+    if (-1 == slashPos)
+    {
+      // Use string for title _and_ artist.
+      info_.set(Artist, dtitle_);
+      info_.set(Title, dtitle_);
+    }
+    else
+    {
+      info_.set(Artist, dtitle_.left(slashPos).trimmed());
+      info_.set(Title, dtitle_.mid(slashPos + 3).trimmed());
+    }
+
+    bool isSampler = true;
+    for (int i = 0; i < info_.numberOfTracks(); ++i)
+    {
+      if (!info_.track(i).get(Title).toString().contains(QLatin1String( " / " )))
+      {
+        isSampler = false;
+        break;
+      }
+    }
+
+    for (int i = 0; i < info_.numberOfTracks(); ++i)
+    {
+      TrackInfo &ti = info_.track(i);
+
+      if (isSampler)
+      {
+        const QString title = ti.get(Title).toString();
+        int delimiter = title.indexOf(QLatin1String( " / " ));
+        ti.set(Artist, title.left(delimiter));
+        ti.set(Title, title.mid(delimiter + 3));
+      }
+      else
+      {
+        ti.set(Artist, info_.get(Artist));
+      }
+    }
+
+    if ( info_.get(Genre).toString().isEmpty() )
+      info_.set(Genre, QLatin1String( "Unknown" ));
+
+    qCDebug(LIBKCDDB) << "Loaded CDInfo for " << info_.get(QLatin1String( "discid" )).toString();
+  }
+}
+
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
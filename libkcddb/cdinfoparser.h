@@ -0,0 +1,95 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCDDB_CDINFOPARSER_H
+#define KCDDB_CDINFOPARSER_H
+
+#include "kcddb_tests_export.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QStringView>
+
+namespace KCDDB
+{
+  class CDInfo;
+
+  /**
+   * Reads CDDB formatted lines into a CDInfo.
+   *
+   * Each line is scanned once, in place: keys are matched without being
+   * copied, and only the values that are kept are turned into strings.
+   * Lines can be given as QString or as UTF-8 encoded bytes, the latter
+   * saves converting the whole input to UTF-16 first.
+   * Call finish() once all lines have been parsed, it splits the disc
+   * title and fills in the fields that depend on all of the entry.
+   *
+   * Data arriving from the network can be fed in chunks of any size
+   * instead. The entry is finished at the "." line that ends it in server
+   * responses, or when finish() is called.
+   */
+  class KCDDB_TESTS_EXPORT CDInfoParser
+  {
+    public:
+      explicit CDInfoParser( CDInfo &info );
+
+      /**
+       * Parses a single line, with or without its line terminator
+       */
+      void parseLine( QStringView line );
+      /**
+       * Parses a single line of UTF-8 encoded data. Only the values that
+       * are kept are decoded.
+       */
+      void parseLine( const QByteArray &line );
+
+      /**
+       * Parses all lines of @p text
+       */
+      void parse( QStringView text );
+      void parse( const QByteArray &text );
+
+      /**
+       * Parses the next chunk of UTF-8 encoded data. Chunks may end in the
+       * middle of a line, the rest of it is expected in the next chunk.
+       * @return the number of bytes used, which is less than the size of
+       * @p chunk if the entry ended within it
+       */
+      int feed( const QByteArray &chunk );
+
+      /**
+       * Finishes the entry, parsing what's left of an incomplete last line.
+       * Does nothing if it's already finished.
+       */
+      void finish();
+
+      /**
+       * @return true once the entry is finished
+       */
+      bool isFinished() const;
+
+      /**
+       * Clears the CDInfo and starts over with a new entry
+       */
+      void reset();
+
+    private:
+      template<typename Char>
+      void parseLine( const Char *begin, const Char *end );
+      template<typename Char>
+      void parse( const Char *begin, const Char *end );
+
+      CDInfo &info_;
+      // DTITLE may be split over several lines, it's only split up in finish()
+      QString dtitle_;
+      // The start of a line whose end hasn't been fed yet
+      QByteArray pending_;
+      bool finished_;
+  };
+}
+
+#endif // KCDDB_CDINFOPARSER_H
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
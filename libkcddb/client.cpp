@@ -19,11 +19,14 @@
 #include "synchttpsubmit.h"
 
 #include "config-musicbrainz.h"
-#ifdef HAVE_MUSICBRAINZ5
+#ifdef HAVE_MUSICBRAINZ
 #include "musicbrainz/musicbrainzlookup.h"
 #include "musicbrainz/asyncmusicbrainzlookup.h"
 #endif
 
+#include <QHash>
+#include <QTimer>
+
 namespace KCDDB
 {
   class Client::Private
@@ -33,7 +36,9 @@ namespace KCDDB
       Private()
         : cdInfoLookup(nullptr),
           cdInfoSubmit(nullptr),
-          block( true )
+          block( true ),
+          batch( false ),
+          storeNegative( false )
       {}
 
       ~Private()
@@ -41,6 +46,15 @@ namespace KCDDB
         delete cdInfoLookup;
         delete cdInfoSubmit;
         qDeleteAll(pendingLookups);
+        qDeleteAll(runningLookups);
+      }
+
+      // Caches what lookup found, along with the other discs it happened
+      // to find out about
+      void storeResponse( Lookup *lookup )
+      {
+        Cache::store( signature, lookup->lookupResponse(), config );
+        Cache::storeRelated( lookup->relatedResponse(), config );
       }
 
       Lookup * cdInfoLookup;
@@ -48,15 +62,26 @@ namespace KCDDB
 
       Config config;
       CDInfoList cdInfoList;
-      TrackOffsetList trackOffsetList;
+      DiscSignature signature;
       QList<Lookup *> pendingLookups;
+      // Lookups running at the same time, by priority, and the results of
+      // those that are done
+      QList<Lookup *> runningLookups;
+      QHash<Lookup *, Result> finishedLookups;
+      QTimer deadline;
       bool block;
+      bool batch;
+      // Whether all sources tried so far said they don't know the disc
+      bool storeNegative;
   };
 
   Client::Client()
     : d(new Private)
   {
     d->config.load();
+
+    d->deadline.setSingleShot( true );
+    connect( &d->deadline, &QTimer::timeout, this, [this] { checkConcurrentLookups( true ); } );
   }
 
   Client::~Client()
@@ -82,6 +107,18 @@ namespace KCDDB
     return d->block;
   }
 
+    void
+  Client::setBatchMode( bool enable )
+  {
+    d->batch = enable;
+  }
+
+    bool
+  Client::batchMode() const
+  {
+    return d->batch;
+  }
+
     CDInfoList
   Client::lookupResponse() const
   {
@@ -90,11 +127,17 @@ namespace KCDDB
 
     Result
   Client::lookup(const TrackOffsetList & trackOffsetList)
+  {
+    return lookup( DiscSignature( trackOffsetList ) );
+  }
+
+    Result
+  Client::lookup(const DiscSignature & signature)
   {
     d->cdInfoList.clear();
-    d->trackOffsetList = trackOffsetList;
+    d->signature = signature;
 
-    if ( trackOffsetList.count() <= 1 )
+    if ( signature.numberOfTracks() < 1 )
     {
 	  qCDebug(LIBKCDDB) << "Lookup called with empty offset list";
       return NoRecordFound;
@@ -102,7 +145,7 @@ namespace KCDDB
 
     if ( d->config.cacheLookupEnabled() )
     {
-      d->cdInfoList = Cache::lookup( trackOffsetList, config() );
+      d->cdInfoList = Cache::lookup( signature, config() );
 
 	  qCDebug(LIBKCDDB) << "Found " << d->cdInfoList.count() << " hit(s)";
 
@@ -113,6 +156,14 @@ namespace KCDDB
 
         return Success;
       }
+
+      if ( Cache::lookupNegative( signature, config() ) )
+      {
+        if ( !blockingMode() )
+          Q_EMIT finished( NoRecordFound );
+
+        return NoRecordFound;
+      }
     }
 
     Result r = NoRecordFound;
@@ -122,25 +173,37 @@ namespace KCDDB
     d->cdInfoLookup = nullptr;
     qDeleteAll(d->pendingLookups);
     d->pendingLookups.clear();
+    qDeleteAll(d->runningLookups);
+    d->runningLookups.clear();
+    d->finishedLookups.clear();
+    d->deadline.stop();
+
+    d->storeNegative = d->config.musicBrainzLookupEnabled() || d->config.freedbLookupEnabled();
 
     if ( blockingMode() )
     {
-#ifdef HAVE_MUSICBRAINZ5
+#ifdef HAVE_MUSICBRAINZ
       if ( d->config.musicBrainzLookupEnabled() )
       {
-        d->cdInfoLookup = new MusicBrainzLookup();
+        MusicBrainzLookup* lookup = new MusicBrainzLookup();
+        lookup->setPriority( batchMode() ? MusicBrainzScheduler::Batch : MusicBrainzScheduler::Interactive );
+        lookup->setServer( QUrl( d->config.musicBrainzServer() ) );
+        d->cdInfoLookup = lookup;
 
         r = d->cdInfoLookup->lookup( d->config.hostname(),
-                d->config.port(), trackOffsetList );
+                d->config.port(), signature );
 
         if ( Success == r )
         {
           d->cdInfoList = d->cdInfoLookup->lookupResponse();
-          Cache::store( d->trackOffsetList, d->cdInfoList, config() );
+          d->storeResponse( d->cdInfoLookup );
 
           return r;
         }
 
+        if ( NoRecordFound != r )
+          d->storeNegative = false;
+
         delete d->cdInfoLookup;
         d->cdInfoLookup = nullptr;
       }
@@ -155,28 +218,36 @@ namespace KCDDB
           d->cdInfoLookup = new SyncHTTPLookup();
 
         r = d->cdInfoLookup->lookup( d->config.hostname(),
-                d->config.port(), trackOffsetList );
+                d->config.port(), signature );
 
         if ( Success == r )
         {
           d->cdInfoList = d->cdInfoLookup->lookupResponse();
-          Cache::store( d->trackOffsetList, d->cdInfoList, config() );
+          d->storeResponse( d->cdInfoLookup );
 
           return r;
         }
 
+        if ( NoRecordFound != r )
+          d->storeNegative = false;
+
         delete d->cdInfoLookup;
         d->cdInfoLookup = nullptr;
       }
 
+      if ( d->storeNegative )
+        Cache::storeNegative( d->signature, config() );
+
       return r;
     }
     else
     {
-#ifdef HAVE_MUSICBRAINZ5
+#ifdef HAVE_MUSICBRAINZ
       if ( d->config.musicBrainzLookupEnabled() )
       {
         AsyncMusicBrainzLookup* lookup = new AsyncMusicBrainzLookup();
+        lookup->setPriority( batchMode() ? MusicBrainzScheduler::Batch : MusicBrainzScheduler::Interactive );
+        lookup->setServer( QUrl( d->config.musicBrainzServer() ) );
 
         connect( lookup, &AsyncMusicBrainzLookup::finished,
                  this, &Client::slotFinished );
@@ -199,6 +270,8 @@ namespace KCDDB
         else
         {
           AsyncHTTPLookup* lookup = new AsyncHTTPLookup();
+          lookup->setBackend( HTTPJob::Backend( d->config.httpBackend() ) );
+          lookup->setConcurrentReads( d->config.httpConcurrentReads() );
 
           connect( lookup, &AsyncHTTPLookup::finished,
                    this, &Client::slotFinished );
@@ -206,6 +279,10 @@ namespace KCDDB
         }
       }
 
+      if ( d->config.lookupStrategy() != Config::EnumLookupStrategy::Sequential
+          && d->pendingLookups.count() > 1 )
+        return startConcurrentLookups();
+
       return runPendingLookups();
     }
   }
@@ -213,10 +290,28 @@ namespace KCDDB
     void
   Client::slotFinished( Result r )
   {
+    if ( !d->runningLookups.isEmpty() )
+    {
+      for ( Lookup *lookup : qAsConst( d->runningLookups ) )
+      {
+        if ( static_cast<QObject *>( lookup ) != sender() )
+          continue;
+
+        if ( Success != r && NoRecordFound != r )
+          d->storeNegative = false;
+
+        d->finishedLookups.insert( lookup, r );
+        checkConcurrentLookups( false );
+        break;
+      }
+
+      return;
+    }
+
     if ( d->cdInfoLookup && Success == r )
     {
       d->cdInfoList = d->cdInfoLookup->lookupResponse();
-      Cache::store( d->trackOffsetList, d->cdInfoList, config() );
+      d->storeResponse( d->cdInfoLookup );
     }
     else
       d->cdInfoList.clear();
@@ -235,6 +330,9 @@ namespace KCDDB
     }
     else
     {
+      if ( NoRecordFound != r )
+        d->storeNegative = false;
+
       runPendingLookups();
     }
   }
@@ -274,16 +372,21 @@ namespace KCDDB
     QString hostname = d->config.httpSubmitServer();
     uint port = d->config.httpSubmitPort();
 
+    HTTPSubmit *httpSubmit;
+
     if ( blockingMode() )
-      d->cdInfoSubmit = new SyncHTTPSubmit(from, hostname, port);
+      httpSubmit = new SyncHTTPSubmit(from, hostname, port);
     else
     {
-      d->cdInfoSubmit = new AsyncHTTPSubmit(from, hostname, port);
-      connect( static_cast<AsyncHTTPSubmit *>( d->cdInfoSubmit ),
+      httpSubmit = new AsyncHTTPSubmit(from, hostname, port);
+      connect( static_cast<AsyncHTTPSubmit *>( httpSubmit ),
               &AsyncHTTPSubmit::finished,
               this, &Client::slotSubmitFinished );
     }
 
+    httpSubmit->setBackend( HTTPJob::Backend( d->config.httpBackend() ) );
+    d->cdInfoSubmit = httpSubmit;
+
     Result r = d->cdInfoSubmit->submit( cdInfo, offsetList );
 
     if ( blockingMode() )
@@ -303,10 +406,13 @@ namespace KCDDB
       d->cdInfoLookup = d->pendingLookups.takeFirst();
 
       Result r = d->cdInfoLookup->lookup( d->config.hostname(),
-              d->config.port(), d->trackOffsetList );
+              d->config.port(), d->signature );
 
       if ( Success != r )
       {
+        if ( NoRecordFound != r )
+          d->storeNegative = false;
+
         delete d->cdInfoLookup;
         d->cdInfoLookup = nullptr;
       }
@@ -315,15 +421,139 @@ namespace KCDDB
     }
     else
     {
+      if ( d->storeNegative )
+        Cache::storeNegative( d->signature, config() );
+
       Q_EMIT finished( NoRecordFound );
       return NoRecordFound;
     }
   }
 
+    Result
+  Client::startConcurrentLookups()
+  {
+    d->runningLookups = d->pendingLookups;
+    d->pendingLookups.clear();
+
+    Result r = NoRecordFound;
+    bool started = false;
+
+    for ( Lookup *lookup : qAsConst( d->runningLookups ) )
+    {
+      const Result result = lookup->lookup( d->config.hostname(),
+              d->config.port(), d->signature );
+
+      if ( Success == result )
+      {
+        started = true;
+        continue;
+      }
+
+      if ( NoRecordFound != result )
+        d->storeNegative = false;
+
+      if ( NoRecordFound == r )
+        r = result;
+
+      d->finishedLookups.insert( lookup, result );
+    }
+
+    // Like runPendingLookups(), a lookup that can't be started is reported
+    // right away, without finished()
+    if ( !started )
+    {
+      qDeleteAll( d->runningLookups );
+      d->runningLookups.clear();
+      d->finishedLookups.clear();
+      return r;
+    }
+
+    if ( d->config.lookupDeadline() > 0 )
+      d->deadline.start( d->config.lookupDeadline() );
+
+    checkConcurrentLookups( false );
+
+    return Success;
+  }
+
+    void
+  Client::checkConcurrentLookups( bool deadlinePassed )
+  {
+    if ( d->runningLookups.isEmpty() )
+      return;
+
+    const bool firstSuccess =
+      d->config.lookupStrategy() == Config::EnumLookupStrategy::FirstSuccess;
+
+    QList<Lookup *> succeeded;
+    bool pending = false;
+
+    for ( Lookup *lookup : qAsConst( d->runningLookups ) )
+    {
+      if ( !d->finishedLookups.contains( lookup ) )
+      {
+        // A source that is still running may yet beat the ones after it
+        if ( !deadlinePassed )
+          return;
+
+        pending = true;
+        continue;
+      }
+
+      if ( Success == d->finishedLookups.value( lookup ) )
+      {
+        succeeded << lookup;
+
+        if ( firstSuccess )
+          break;
+      }
+    }
+
+    d->deadline.stop();
+
+    d->cdInfoList.clear();
+    for ( Lookup *lookup : qAsConst( succeeded ) )
+    {
+      d->cdInfoList << lookup->lookupResponse();
+      d->storeResponse( lookup );
+    }
+
+    // The slower sources aren't needed anymore. One of them may be
+    // emitting the signal that brought us here, so don't delete it now.
+    const QList<Lookup *> lookups = d->runningLookups;
+    d->runningLookups.clear();
+    d->finishedLookups.clear();
+
+    for ( Lookup *lookup : lookups )
+    {
+      disconnect( lookup, nullptr, this, nullptr );
+      lookup->deleteLater();
+    }
+
+    if ( !d->cdInfoList.isEmpty() )
+    {
+      Q_EMIT finished( Success );
+      return;
+    }
+
+    // Only if every source had its say
+    if ( d->storeNegative && !pending )
+      Cache::storeNegative( d->signature, config() );
+
+    // Sources that didn't answer in time may still know the disc
+    Q_EMIT finished( pending ? NoResponse : NoRecordFound );
+  }
+
     void
   Client::store(const CDInfo &cdInfo, const TrackOffsetList& offsetList)
   {
-    Cache::store(offsetList, cdInfo, config());
+    store(cdInfo, DiscSignature(offsetList));
+  }
+
+    void
+  Client::store(const CDInfo &cdInfo, const DiscSignature& signature)
+  {
+    Cache::store(signature, cdInfo, config());
   }
 }
 
@@ -11,6 +11,7 @@
 #include "cdinfo.h"
 #include "kcddb.h"
 #include "config.h"
+#include "discsignature.h"
 
 #include <QObject>
 
@@ -57,6 +58,10 @@ namespace KCDDB
        * @return if the results of the lookup: Success, NoRecordFound, etc
        */
       Result lookup(const TrackOffsetList &trackOffsetList);
+      /**
+       * Same as above, for a disc whose ids have already been calculated
+       */
+      Result lookup(const DiscSignature &signature);
       /**
        * @returns the results of trying to submit
        */
@@ -66,10 +71,23 @@ namespace KCDDB
        * Stores the CD-information in the local cache
        */
       void store(const CDInfo &cdInfo, const TrackOffsetList &trackOffsetList);
+      void store(const CDInfo &cdInfo, const DiscSignature &signature);
 
+      /**
+       * Blocking HTTP lookups don't go through KIO, so they use the system
+       * proxy settings, e.g. $http_proxy, rather than the ones of KDE
+       */
       void setBlockingMode( bool );
       bool blockingMode() const;
 
+      /**
+       * Lookups in batch mode let interactive lookups go first where
+       * servers limit how many requests they take, as MusicBrainz does.
+       * Use it when looking up many discs at once.
+       */
+      void setBatchMode( bool );
+      bool batchMode() const;
+
     Q_SIGNALS:
       /**
        * emitted when not blocking and lookup() finished.
@@ -88,6 +106,8 @@ namespace KCDDB
 
     private:
       Result runPendingLookups();
+      Result startConcurrentLookups();
+      void checkConcurrentLookups( bool deadlinePassed );
 
       class Private;
       Private * const d;
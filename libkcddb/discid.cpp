@@ -0,0 +1,185 @@
+/*
+    SPDX-FileCopyrightText: 2002 Rik Hemsley (rikkus) <rik@kde.org>
+    SPDX-FileCopyrightText: 2005-2007 Richard Lärkäng <nouseforaname@home.se>
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "discid.h"
+
+#include <QCryptographicHash>
+
+namespace KCDDB
+{
+  namespace
+  {
+    const char lowerHexDigits[] = "0123456789abcdef";
+    const char upperHexDigits[] = "0123456789ABCDEF";
+
+    // Base64 with '/', '+' and '=' replaced, as MusicBrainz uses it in URLs
+    const char musicBrainzBase64[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789._";
+
+      inline void
+    writeHex( char *out, quint32 value, int digits, const char *hexDigits )
+    {
+      for ( int i = digits - 1; i >= 0; --i )
+      {
+        out[ i ] = hexDigits[ value & 0xf ];
+        value >>= 4;
+      }
+    }
+
+    /**
+     * Writes the 28 character MusicBrainz id of @p list and a terminating
+     * 0 to @p out
+     */
+      void
+    writeMusicBrainzId( const TrackOffsetList &list, char *out )
+    {
+      // Code based on libmusicbrainz/lib/diskid.cpp: the id is the SHA-1 of
+      // the first and last track number, the lead-out offset and the offsets
+      // of 99 tracks, all in upper case hex
+      char data[ 2 + 2 + 100 * 8 ];
+
+      const int numTracks = list.count() - 1;
+
+      // FIXME How do I check that?
+      const int firstTrack = 1;
+      const int lastTrack = numTracks;
+
+      writeHex( data, firstTrack, 2, upperHexDigits );
+      writeHex( data + 2, lastTrack, 2, upperHexDigits );
+
+      for ( int i = 0; i < 100; ++i )
+      {
+        quint32 offset;
+        if ( i == 0 )
+          offset = list[ numTracks ];
+        else if ( i <= numTracks )
+          offset = list[ i - 1 ];
+        else
+          offset = 0;
+
+        writeHex( data + 4 + i * 8, offset, 8, upperHexDigits );
+      }
+
+      const QByteArray hash = QCryptographicHash::hash(
+          QByteArray::fromRawData( data, sizeof( data ) ), QCryptographicHash::Sha1 );
+      const uchar *in = reinterpret_cast<const uchar *>( hash.constData() );
+
+      // 20 bytes of hash, 6 groups of 3 bytes and one of 2 bytes with padding
+      for ( int i = 0; i < 6; ++i, in += 3, out += 4 )
+      {
+        const quint32 group = ( in[ 0 ] << 16 ) | ( in[ 1 ] << 8 ) | in[ 2 ];
+        out[ 0 ] = musicBrainzBase64[ group >> 18 ];
+        out[ 1 ] = musicBrainzBase64[ ( group >> 12 ) & 0x3f ];
+        out[ 2 ] = musicBrainzBase64[ ( group >> 6 ) & 0x3f ];
+        out[ 3 ] = musicBrainzBase64[ group & 0x3f ];
+      }
+
+      const quint32 group = ( in[ 0 ] << 16 ) | ( in[ 1 ] << 8 );
+      out[ 0 ] = musicBrainzBase64[ group >> 18 ];
+      out[ 1 ] = musicBrainzBase64[ ( group >> 12 ) & 0x3f ];
+      out[ 2 ] = musicBrainzBase64[ ( group >> 6 ) & 0x3f ];
+      out[ 3 ] = '-';
+      out[ 4 ] = '\0';
+    }
+  }
+
+    quint32
+  DiscId::freedbId( const TrackOffsetList &list )
+  {
+    // Taken from version by Michael Matz in kio_audiocd.
+    quint32 id = 0;
+    if ( list.isEmpty() )
+      return 0;
+    int numTracks = list.count() - 1;
+
+    // The last two in the list are disc begin and disc end.
+    for ( int i = numTracks-1; i >= 0; i-- )
+    {
+      uint n = list[ i ]/75;
+      while ( n > 0 )
+      {
+        id += n % 10;
+        n /= 10;
+      }
+    }
+
+    quint32 l = list[numTracks] / 75;
+    l -= list[0] / 75;
+
+    return ( ( id % 255 ) << 24 ) | ( l << 8 ) | numTracks;
+  }
+
+    void
+  DiscId::formatFreedbId( quint32 id, char *out )
+  {
+    writeHex( out, id, 8, lowerHexDigits );
+  }
+
+    QString
+  DiscId::freedbIdString( const TrackOffsetList &list )
+  {
+    if ( list.isEmpty() )
+      return QString();
+
+    char hex[ 8 ];
+    formatFreedbId( freedbId( list ), hex );
+    return QString::fromLatin1( hex, 8 );
+  }
+
+    QString
+  DiscId::musicBrainzId( const TrackOffsetList &list )
+  {
+    if ( list.isEmpty() )
+      return QString();
+
+    char id[ 29 ];
+    writeMusicBrainzId( list, id );
+    return QString::fromLatin1( id, 28 );
+  }
+
+    void
+  DiscId::calculate( const TrackOffsetList *lists, int count, DiscIds *ids )
+  {
+    for ( int i = 0; i < count; ++i )
+    {
+      const TrackOffsetList &list = lists[ i ];
+      DiscIds &id = ids[ i ];
+
+      if ( list.isEmpty() )
+      {
+        id.freedbId = 0;
+        id.freedbIdHex[ 0 ] = '\0';
+        id.musicBrainzId[ 0 ] = '\0';
+        continue;
+      }
+
+      id.freedbId = freedbId( list );
+      formatFreedbId( id.freedbId, id.freedbIdHex );
+      id.freedbIdHex[ 8 ] = '\0';
+      writeMusicBrainzId( list, id.musicBrainzId );
+    }
+  }
+
+    QList<DiscIds>
+  DiscId::calculate( const QList<TrackOffsetList> &lists )
+  {
+    QList<DiscIds> ids;
+    ids.reserve( lists.count() );
+
+    for ( const TrackOffsetList &list : lists )
+    {
+      DiscIds id;
+      calculate( &list, 1, &id );
+      ids.append( id );
+    }
+
+    return ids;
+  }
+}
+
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
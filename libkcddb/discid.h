@@ -0,0 +1,90 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCDDB_DISCID_H
+#define KCDDB_DISCID_H
+
+#include "kcddb_export.h"
+#include "kcddb.h"
+
+#include <QList>
+#include <QString>
+
+namespace KCDDB
+{
+  /**
+   * The ids of one disc, as calculated by DiscId::calculate()
+   */
+  struct DiscIds
+  {
+    /**
+     * The freedb disc id as a number, 0 for an empty TrackOffsetList
+     */
+    quint32 freedbId;
+    /**
+     * The freedb disc id as 8 lower case hex digits, empty for an empty
+     * TrackOffsetList
+     */
+    char freedbIdHex[9];
+    /**
+     * The 28 character MusicBrainz disc id, empty for an empty
+     * TrackOffsetList
+     */
+    char musicBrainzId[29];
+
+    QString freedbIdString() const { return QString::fromLatin1(freedbIdHex); }
+    QString musicBrainzIdString() const { return QString::fromLatin1(musicBrainzId); }
+  };
+
+  /**
+   * Calculates the ids freedb and MusicBrainz use to identify a disc from
+   * its TrackOffsetList.
+   *
+   * Everything but the QString returning functions works on fixed size
+   * buffers, so ids for whole archives of discs can be calculated without
+   * allocating memory for each one.
+   */
+  class KCDDB_EXPORT DiscId
+  {
+    public:
+      /**
+       * @return the freedb disc id of @p list, 0 if it's empty
+       */
+      static quint32 freedbId( const TrackOffsetList &list );
+
+      /**
+       * Writes @p id as 8 lower case hex digits to @p out, which doesn't
+       * get terminated
+       */
+      static void formatFreedbId( quint32 id, char *out );
+
+      /**
+       * @return the freedb disc id of @p list as 8 lower case hex digits,
+       * or a null string if it's empty
+       */
+      static QString freedbIdString( const TrackOffsetList &list );
+
+      /**
+       * @return the MusicBrainz disc id of @p list, or a null string if
+       * it's empty
+       */
+      static QString musicBrainzId( const TrackOffsetList &list );
+
+      /**
+       * Calculates the ids of the @p count discs starting at @p lists,
+       * and stores them in @p ids, which needs room for @p count entries
+       */
+      static void calculate( const TrackOffsetList *lists, int count, DiscIds *ids );
+
+      /**
+       * @return the ids of all discs in @p lists, in the same order
+       */
+      static QList<DiscIds> calculate( const QList<TrackOffsetList> &lists );
+  };
+}
+
+#endif // KCDDB_DISCID_H
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -0,0 +1,134 @@
+/*
+    SPDX-FileCopyrightText: 2002 Rik Hemsley (rikkus) <rik@kde.org>
+    SPDX-FileCopyrightText: 2002 Benjamin Meyer <ben-devel@meyerhome.net>
+    SPDX-FileCopyrightText: 2002 Nadeem Hasan <nhasan@kde.org>
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "discsignature.h"
+#include "discid.h"
+
+#include <QSharedData>
+
+namespace KCDDB
+{
+  class DiscSignaturePrivate : public QSharedData
+  {
+    public:
+      TrackOffsetList trackOffsetList;
+      QString freedbId;
+      QString musicBrainzId;
+      QString queryString;
+  };
+
+  namespace
+  {
+      QString
+    makeQueryString( const TrackOffsetList &list )
+    {
+      if ( list.isEmpty() )
+        return QString();
+
+      QString ret;
+      const int numTracks = list.count() - 1;
+
+      // Disc start.
+      ret.append( QString::number( numTracks ) );
+      ret.append( QLatin1String( " " ) );
+
+      for ( int i = 0; i < numTracks; i++ )
+      {
+        ret.append( QString::number( list[ i ] ) );
+        ret.append( QLatin1String( " " ) );
+      }
+
+      unsigned int discLengthInSec = ( list[ numTracks ] ) / 75;
+
+      ret.append( QString::number( discLengthInSec ) );
+
+      return ret;
+    }
+  }
+
+  DiscSignature::DiscSignature()
+    : d(new DiscSignaturePrivate())
+  {
+  }
+
+  DiscSignature::DiscSignature(const TrackOffsetList &trackOffsetList)
+    : d(new DiscSignaturePrivate())
+  {
+    DiscIds ids;
+    DiscId::calculate(&trackOffsetList, 1, &ids);
+
+    d->trackOffsetList = trackOffsetList;
+    d->freedbId = ids.freedbIdString();
+    d->musicBrainzId = ids.musicBrainzIdString();
+    d->queryString = makeQueryString(trackOffsetList);
+  }
+
+  DiscSignature::~DiscSignature()
+  {
+  }
+
+  DiscSignature::DiscSignature(const DiscSignature& clone) = default;
+
+  DiscSignature::DiscSignature(DiscSignature&& other) noexcept = default;
+
+  DiscSignature& DiscSignature::operator=(const DiscSignature& clone) = default;
+
+  DiscSignature& DiscSignature::operator=(DiscSignature&& other) noexcept = default;
+
+    bool
+  DiscSignature::operator==(const DiscSignature& other) const
+  {
+    // Everything else follows from the offsets
+    return d == other.d || d->trackOffsetList == other.d->trackOffsetList;
+  }
+
+    bool
+  DiscSignature::operator!=(const DiscSignature& other) const
+  {
+    return !(*this == other);
+  }
+
+    bool
+  DiscSignature::isEmpty() const
+  {
+    return d->trackOffsetList.isEmpty();
+  }
+
+    int
+  DiscSignature::numberOfTracks() const
+  {
+    return qMax(0, d->trackOffsetList.count() - 1);
+  }
+
+    const TrackOffsetList &
+  DiscSignature::trackOffsetList() const
+  {
+    return d->trackOffsetList;
+  }
+
+    QString
+  DiscSignature::freedbId() const
+  {
+    return d->freedbId;
+  }
+
+    QString
+  DiscSignature::musicBrainzId() const
+  {
+    return d->musicBrainzId;
+  }
+
+    QString
+  DiscSignature::queryString() const
+  {
+    return d->queryString;
+  }
+}
+
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -0,0 +1,81 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCDDB_DISCSIGNATURE_H
+#define KCDDB_DISCSIGNATURE_H
+
+#include "kcddb_export.h"
+#include "kcddb.h"
+
+#include <QSharedDataPointer>
+#include <QString>
+
+namespace KCDDB
+{
+  class DiscSignaturePrivate;
+
+  /**
+   * The track offsets of a disc, together with everything derived from
+   * them that lookups need: the freedb disc id, the MusicBrainz disc id and
+   * the offsets as sent in a freedb query.
+   *
+   * They are all calculated once, when the signature is created, so a
+   * lookup going through the cache and several servers doesn't repeat the
+   * work. DiscSignature is implicitly shared, copies are cheap.
+   */
+  class KCDDB_EXPORT DiscSignature
+  {
+    public:
+      DiscSignature();
+      /**
+       * @param trackOffsetList the start offsets of the tracks, and the
+       * offset of the lead-out track at the end of the list
+       */
+      DiscSignature(const TrackOffsetList &trackOffsetList);
+      ~DiscSignature();
+      DiscSignature(const DiscSignature& clone);
+      DiscSignature(DiscSignature&& other) noexcept;
+      DiscSignature& operator=(const DiscSignature& clone);
+      DiscSignature& operator=(DiscSignature&& other) noexcept;
+
+      bool operator==(const DiscSignature&) const;
+      bool operator!=(const DiscSignature&) const;
+
+      /**
+       * @return true if there are no track offsets
+       */
+      bool isEmpty() const;
+
+      /**
+       * @return the number of tracks, not counting the lead-out
+       */
+      int numberOfTracks() const;
+
+      const TrackOffsetList &trackOffsetList() const;
+
+      /**
+       * @return the freedb disc id, 8 lower case hex digits
+       */
+      QString freedbId() const;
+
+      /**
+       * @return the 28 character MusicBrainz disc id
+       */
+      QString musicBrainzId() const;
+
+      /**
+       * @return the number of tracks, their offsets and the length of the
+       * disc in seconds, as they follow the disc id in a "cddb query"
+       */
+      QString queryString() const;
+
+    private:
+      QSharedDataPointer<DiscSignaturePrivate> d;
+  };
+}
+
+#endif // KCDDB_DISCSIGNATURE_H
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -0,0 +1,230 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "httpjob.h"
+#include "cddb.h"
+
+#include <KIO/TransferJob>
+
+#include <QEventLoop>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QThreadStorage>
+#include <QUrl>
+
+namespace KCDDB
+{
+  namespace
+  {
+    class KIOHTTPJob : public HTTPJob
+    {
+      public:
+        explicit KIOHTTPJob( KIO::TransferJob *job )
+          : job_( job )
+        {
+          connect( job, &KIO::TransferJob::data, this, [this]( KIO::Job *, const QByteArray &d ) {
+            // KIO signals the end of the data with an empty array
+            if ( !d.isEmpty() )
+              Q_EMIT data( this, d );
+          });
+          connect( job, &KJob::result, this, [this]( KJob *job ) {
+            emitResult( job->error(), job->errorString() );
+          });
+        }
+
+      protected:
+        void abort() override
+        {
+          // Quietly, so result isn't emitted, and the job deletes itself
+          if ( job_ )
+            job_->kill();
+        }
+
+      private:
+        QPointer<KIO::TransferJob> job_;
+    };
+
+    class NetworkHTTPJob : public HTTPJob
+    {
+      public:
+        explicit NetworkHTTPJob( QNetworkReply *reply )
+          : reply_( reply )
+        {
+          reply->setParent( this );
+
+          connect( reply, &QIODevice::readyRead, this, [this, reply]() {
+            Q_EMIT data( this, reply->readAll() );
+          });
+          connect( reply, &QNetworkReply::finished, this, [this, reply]() {
+            const QByteArray rest = reply->readAll();
+            if ( !rest.isEmpty() )
+              Q_EMIT data( this, rest );
+
+            if ( QNetworkReply::NoError == reply->error() )
+              emitResult( 0, QString() );
+            else
+              emitResult( reply->error(), reply->errorString() );
+          });
+        }
+
+      protected:
+        void abort() override
+        {
+          // abort() emits finished
+          reply_->disconnect( this );
+          reply_->abort();
+        }
+
+      private:
+        QNetworkReply *reply_;
+    };
+
+    // A manager can only be used from the thread it was created in
+    Q_GLOBAL_STATIC(QThreadStorage<QNetworkAccessManager *>, s_managers)
+
+      QNetworkAccessManager *
+    networkManager()
+    {
+      if ( !s_managers->hasLocalData() )
+      {
+        QNetworkAccessManager *manager = new QNetworkAccessManager;
+        manager->setRedirectPolicy( QNetworkRequest::NoLessSafeRedirectPolicy );
+        s_managers->setLocalData( manager );
+      }
+
+      return s_managers->localData();
+    }
+
+      QNetworkRequest
+    networkRequest( const QUrl &url )
+    {
+      // The manager keeps connections to a server open between requests,
+      // and asks for and decodes gzip and deflate responses by itself
+      QNetworkRequest request( url );
+      request.setAttribute( QNetworkRequest::Http2AllowedAttribute, true );
+      request.setHeader( QNetworkRequest::UserAgentHeader,
+          QString( CDDB::clientName() + QLatin1Char( '/' ) + CDDB::clientVersion() ) );
+      return request;
+    }
+  }
+
+  HTTPJob::HTTPJob()
+    : error_( 0 ), finished_( false ), inExec_( false )
+  {
+  }
+
+  HTTPJob::~HTTPJob()
+  {
+  }
+
+    HTTPJob *
+  HTTPJob::get( const QUrl &url, Backend backend )
+  {
+    if ( QtNetworkBackend == backend )
+      return new NetworkHTTPJob( networkManager()->get( networkRequest( url ) ) );
+
+    return new KIOHTTPJob( KIO::get( url, KIO::NoReload, KIO::HideProgressInfo ) );
+  }
+
+    HTTPJob *
+  HTTPJob::post( const QUrl &url, const QByteArray &data,
+      const HTTPHeaderList &headers, Backend backend )
+  {
+    if ( QtNetworkBackend == backend )
+    {
+      QNetworkRequest request = networkRequest( url );
+      for ( const auto &header : headers )
+        request.setRawHeader( header.first, header.second );
+
+      return new NetworkHTTPJob( networkManager()->post( request, data ) );
+    }
+
+    KIO::TransferJob *job = KIO::http_post( url, data, KIO::HideProgressInfo );
+
+    QString customHeader;
+    for ( const auto &header : headers )
+    {
+      const QString line = QString::fromUtf8( header.first + ": " + header.second );
+
+      if ( 0 == qstricmp( header.first.constData(), "Content-Type" ) )
+        job->addMetaData( QLatin1String( "content-type" ), line );
+
+      if ( !customHeader.isEmpty() )
+        customHeader += QLatin1Char( '\n' );
+      customHeader += line;
+    }
+
+    job->addMetaData( QLatin1String( "customHTTPHeader" ), customHeader );
+
+    return new KIOHTTPJob( job );
+  }
+
+    bool
+  HTTPJob::exec()
+  {
+    inExec_ = true;
+
+    if ( !finished_ )
+    {
+      QEventLoop loop;
+      connect( this, &HTTPJob::result, &loop, &QEventLoop::quit );
+      loop.exec( QEventLoop::ExcludeUserInputEvents );
+    }
+
+    const bool succeeded = 0 == error_;
+    delete this;
+    return succeeded;
+  }
+
+    void
+  HTTPJob::kill()
+  {
+    if ( finished_ )
+      return;
+
+    abort();
+
+    // exec() is waiting for a result, and deletes the job itself
+    if ( inExec_ )
+      emitResult( QNetworkReply::OperationCanceledError, QString() );
+    else
+    {
+      finished_ = true;
+      deleteLater();
+    }
+  }
+
+    int
+  HTTPJob::error() const
+  {
+    return error_;
+  }
+
+    QString
+  HTTPJob::errorString() const
+  {
+    return errorString_;
+  }
+
+    void
+  HTTPJob::emitResult( int error, const QString &errorString )
+  {
+    error_ = error;
+    errorString_ = errorString;
+    finished_ = true;
+
+    Q_EMIT result( this );
+
+    if ( !inExec_ )
+      deleteLater();
+  }
+}
+
+#include "moc_httpjob.cpp"
+
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -0,0 +1,100 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCDDB_HTTPJOB_H
+#define KCDDB_HTTPJOB_H
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QString>
+
+class QUrl;
+
+namespace KCDDB
+{
+  typedef QList<QPair<QByteArray, QByteArray>> HTTPHeaderList;
+
+  /**
+   * A single HTTP request, run by KIO or by QtNetwork.
+   *
+   * The QtNetwork backend shares one QNetworkAccessManager per thread, so
+   * requests to the same server reuse their connections, use HTTP/2 where
+   * the server offers it and get compressed responses.
+   *
+   * Like a KIO job, an HTTPJob starts by itself once control returns to the
+   * event loop, or when exec() is called, and deletes itself once it has
+   * emitted result().
+   */
+  class HTTPJob : public QObject
+  {
+    Q_OBJECT
+
+    public:
+      /**
+       * Same order as the HTTPBackend choices in the configuration
+       */
+      enum Backend
+      {
+        KIOBackend,
+        QtNetworkBackend
+      };
+
+      static HTTPJob *get( const QUrl &url, Backend backend );
+      static HTTPJob *post( const QUrl &url, const QByteArray &data,
+          const HTTPHeaderList &headers, Backend backend );
+
+      ~HTTPJob() override;
+
+      /**
+       * Runs the job in a local event loop and deletes it
+       * @return true if it succeeded
+       */
+      bool exec();
+
+      /**
+       * Stops the job without emitting result() and deletes it, unless it
+       * has finished already
+       */
+      void kill();
+
+      /**
+       * @return 0 if the job succeeded, a backend specific error code otherwise
+       */
+      int error() const;
+      QString errorString() const;
+
+    Q_SIGNALS:
+      /**
+       * Part of the response body has arrived
+       */
+      void data( KCDDB::HTTPJob *job, const QByteArray &data );
+      /**
+       * The job has finished, see error()
+       */
+      void result( KCDDB::HTTPJob *job );
+
+    protected:
+      HTTPJob();
+
+      void emitResult( int error, const QString &errorString );
+
+      /**
+       * Stops the request, called by kill()
+       */
+      virtual void abort() = 0;
+
+    private:
+      int error_;
+      QString errorString_;
+      bool finished_;
+      bool inExec_;
+  };
+}
+
+#endif // KCDDB_HTTPJOB_H
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -14,7 +14,8 @@ namespace KCDDB
 {
   HTTPLookup::HTTPLookup()
     : Lookup(),
-      block_( true ), state_( Idle ), result_( Success )
+      block_( true ), backend_( HTTPJob::KIOBackend ), state_( Idle ), result_( Success ),
+      cdInfoParser_( cdInfo_ )
   {
   }
 
@@ -22,11 +23,17 @@ namespace KCDDB
   {
   }
 
+    void
+  HTTPLookup::setBackend( HTTPJob::Backend backend )
+  {
+    backend_ = backend;
+  }
+
     Result
   HTTPLookup::sendQuery()
   {
       QString cmd = QString::fromLatin1( "cddb query %1 %2" )
-      .arg( trackOffsetListToId(), trackOffsetListToString() ) ;
+      .arg( signature_.freedbId(), signature_.queryString() ) ;
 
     makeURL( cmd );
     Result result = fetchURL();
@@ -43,6 +50,8 @@ namespace KCDDB
     QString cmd = QString::fromLatin1( "cddb read %1 %2" )
         .arg( category_, discid_ );
 
+    cdInfoParser_.reset();
+
     makeURL( cmd );
     Result result = fetchURL();
 
@@ -141,15 +150,16 @@ namespace KCDDB
       case WaitingForReadResponse:
 
         {
-          CDInfo info;
-
-          if ( info.load( QString::fromUtf8(data_) ) )
-          {
-            info.set( QLatin1String( "category" ), category_ );
-            info.set( QLatin1String( "discid" ), discid_ );
-            info.set( QLatin1String( "source" ), QLatin1String( "freedb" ) );
-            cdInfoList_.append( info );
-          }
+          // Only blocking lookups get here, with all of the entry in
+          // data_. Asynchronous ones parse their reads themselves.
+          cdInfoParser_.feed( data_ );
+          cdInfoParser_.finish();
+
+          CDInfo info = cdInfo_;
+          info.set( QLatin1String( "category" ), category_ );
+          info.set( QLatin1String( "discid" ), discid_ );
+          info.set( QLatin1String( "source" ), QLatin1String( "freedb" ) );
+          cdInfoList_.append( info );
 
           if ( !block_ )
             Q_EMIT readReady();
@@ -10,13 +10,10 @@
 #define KCDDB_HTTP_LOOKUP_H
 
 #include "lookup.h"
+#include "cdinfoparser.h"
+#include "httpjob.h"
 #include <QUrl>
 
-namespace KIO
-{
-  class Job;
-}
-
 namespace KCDDB
 {
   class HTTPLookup : public Lookup
@@ -36,6 +33,8 @@ namespace KCDDB
       HTTPLookup();
       virtual ~HTTPLookup();
 
+      void setBackend( HTTPJob::Backend );
+
     protected:
 
       void initURL( const QString &, uint );
@@ -55,10 +54,14 @@ namespace KCDDB
     protected:
 
       bool block_;
+      HTTPJob::Backend backend_;
       QUrl cgiURL_;
       QByteArray data_;
       State state_;
       Result result_;
+      // The entry being read, see sendRead()
+      CDInfo cdInfo_;
+      CDInfoParser cdInfoParser_;
   };
 }
 
@@ -7,12 +7,10 @@
 
 #include "httpsubmit.h"
 
-#include <KIO/TransferJob>
-
 namespace KCDDB
 {
   HTTPSubmit::HTTPSubmit(const QString& from, const QString& hostname, uint port)
-    : Submit(), from_(from)
+    : Submit(), backend_(HTTPJob::KIOBackend), from_(from)
   {
     url_.setScheme( QLatin1String( "http" ));
     url_.setHost(hostname);
@@ -25,24 +23,24 @@ namespace KCDDB
 
   }
 
-  KIO::Job* HTTPSubmit::createJob(const CDInfo& cdInfo)
+  void HTTPSubmit::setBackend(HTTPJob::Backend backend)
   {
-    KIO::TransferJob* job = KIO::http_post(url_, diskData_.toUtf8().data(), KIO::HideProgressInfo);
-
-    job->addMetaData(QLatin1String( "content-type" ), QLatin1String( "Content-Type: text/plain" ));
-    QString header;
+    backend_ = backend;
+  }
 
-    header += QLatin1String( "Content-Type: text/plain\n" );
+  HTTPJob* HTTPSubmit::createJob(const CDInfo& cdInfo)
+  {
+    HTTPHeaderList headers;
 
-    header += QLatin1String( "Category: " ) + cdInfo.get(Category).toString() + QLatin1Char( '\n' );
-    header += QLatin1String( "Discid: " ) + cdInfo.get(QLatin1String( "discid" )).toString() + QLatin1Char( '\n' );
-    header += QLatin1String( "User-Email: " ) + from_ + QLatin1Char( '\n' );
-    //header += QLatin1String( "Submit-Mode: test\n" );
-    header += QLatin1String( "Submit-Mode: submit\n" );
-    header += QLatin1String( "Charset: UTF-8" );
+    headers << qMakePair(QByteArray("Content-Type"), QByteArray("text/plain"));
 
-    job->addMetaData(QLatin1String( "customHTTPHeader" ), header);
+    headers << qMakePair(QByteArray("Category"), cdInfo.get(Category).toString().toUtf8());
+    headers << qMakePair(QByteArray("Discid"), cdInfo.get(QLatin1String( "discid" )).toString().toUtf8());
+    headers << qMakePair(QByteArray("User-Email"), from_.toUtf8());
+    //headers << qMakePair(QByteArray("Submit-Mode"), QByteArray("test"));
+    headers << qMakePair(QByteArray("Submit-Mode"), QByteArray("submit"));
+    headers << qMakePair(QByteArray("Charset"), QByteArray("UTF-8"));
 
-    return job;
+    return HTTPJob::post(url_, diskData_, headers, backend_);
   }
 }
@@ -8,6 +8,7 @@
 #define HTTPSUBMIT_H
 
 #include "submit.h"
+#include "httpjob.h"
 #include <QUrl>
 
 namespace KCDDB
@@ -18,9 +19,12 @@ namespace KCDDB
       HTTPSubmit(const QString& from, const QString& hostname, uint port);
       virtual ~HTTPSubmit();
 
+      void setBackend(HTTPJob::Backend backend);
+
     protected:
-      KIO::Job* createJob(const CDInfo& cdInfo) override;
+      HTTPJob* createJob(const CDInfo& cdInfo) override;
 
+      HTTPJob::Backend backend_;
       QUrl url_;
       QString from_;
   } ;
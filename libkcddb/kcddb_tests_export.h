@@ -0,0 +1,23 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCDDB_TESTS_EXPORT_H
+#define KCDDB_TESTS_EXPORT_H
+
+#include "kcddb_export.h"
+
+/**
+ * Exports internal classes for the unit tests and benchmarks only, they
+ * aren't part of the API of the library
+ */
+#ifdef BUILD_TESTING
+#define KCDDB_TESTS_EXPORT KCDDB_EXPORT
+#else
+#define KCDDB_TESTS_EXPORT
+#endif
+
+#endif // KCDDB_TESTS_EXPORT_H
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
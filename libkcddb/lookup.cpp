@@ -68,6 +68,12 @@ namespace KCDDB
     return cdInfoList_;
   }
 
+    CDInfoList
+  Lookup::relatedResponse() const
+  {
+    return relatedInfoList_;
+  }
+
 }
 
 // vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
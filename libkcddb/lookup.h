@@ -35,9 +35,15 @@ namespace KCDDB
       Lookup();
       virtual ~Lookup();
 
-      virtual Result lookup( const QString &, uint, const TrackOffsetList & ) = 0;
+      virtual Result lookup( const QString &, uint, const DiscSignature & ) = 0;
 
       CDInfoList lookupResponse() const;
+      /**
+       * Entries for other discs that came along with the lookup, like the
+       * other discs of a release. Their discid says which disc they
+       * belong to; they're only worth keeping in the cache.
+       */
+      CDInfoList relatedResponse() const;
 
     protected:
 
@@ -46,6 +52,7 @@ namespace KCDDB
       Result parseRead(  const QString & );
 
       CDInfoList cdInfoList_;
+      CDInfoList relatedInfoList_;
       CDDBMatchList matchList_;
       QString category_;
       QString discid_;
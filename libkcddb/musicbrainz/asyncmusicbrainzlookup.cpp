@@ -8,69 +8,172 @@
 
 #include "musicbrainzlookup.h"
 
+#include <QAtomicInt>
 #include <QDebug>
-#include <QThread>
+#include <QRunnable>
+#include <QThreadPool>
 
 namespace KCDDB
 {
-  class LookupThread : public QThread
+  namespace
+  {
+    // MusicBrainz takes one request per second anyway, more threads would
+    // only wait in the scheduler
+    const int maxLookupThreads = 4;
+
+    /**
+     * Interactive and batch lookups get threads of their own. The scheduler
+     * lets interactive requests go first, but only once they reach it, which
+     * they wouldn't while batch lookups occupy all threads of a shared pool.
+     */
+    class LookupPools
+    {
+      public:
+        LookupPools()
+        {
+          interactive.setMaxThreadCount(maxLookupThreads);
+          batch.setMaxThreadCount(maxLookupThreads);
+        }
+
+        QThreadPool *pool(MusicBrainzScheduler::Priority priority)
+        {
+          return priority == MusicBrainzScheduler::Interactive ? &interactive : &batch;
+        }
+
+        QThreadPool interactive;
+        QThreadPool batch;
+    };
+
+    Q_GLOBAL_STATIC(LookupPools, s_lookupPools)
+  }
+
+  /**
+   * Runs a MusicBrainzLookup on the lookup pool. It belongs to the thread
+   * that started it and deletes itself when done, unless it's taken off
+   * the pool before it ran.
+   */
+  class LookupTask : public QObject, public QRunnable
   {
 
   Q_OBJECT
 
   public:
-    void run() override
+    LookupTask(const DiscSignature &signature, MusicBrainzScheduler::Priority priority, const QUrl &server)
+      : m_signature(signature), m_priority(priority), m_server(server)
     {
-      Result result;
-      CDInfoList lookupResponse;
-      MusicBrainzLookup lookup;
-
-      result = lookup.lookup(QString(), 0, m_offsetList);
+      setAutoDelete(false);
+    }
 
-      if (result == Success)
-        lookupResponse = lookup.lookupResponse();
+    void run() override
+    {
+      if (!m_cancelled.loadAcquire())
+      {
+        Result result;
+        CDInfoList lookupResponse;
+        CDInfoList relatedResponse;
+        MusicBrainzLookup lookup;
+        lookup.setPriority(m_priority);
+        lookup.setServer(m_server);
+        lookup.setCancelFlag(&m_cancelled);
+
+        result = lookup.lookup(QString(), 0, m_signature);
+
+        if (result == Success)
+        {
+          lookupResponse = lookup.lookupResponse();
+          relatedResponse = lookup.relatedResponse();
+        }
+
+        Q_EMIT lookupFinished(result, lookupResponse, relatedResponse);
+      }
+
+      deleteLater();
+    }
 
-      Q_EMIT lookupFinished(result, lookupResponse);
+    void cancel()
+    {
+      m_cancelled.storeRelease(1);
+      // The lookup may be waiting for its turn, which can take a while
+      // when the server is throttling
+      MusicBrainzScheduler::wakeUp();
     }
 
-    TrackOffsetList m_offsetList;
+    MusicBrainzScheduler::Priority priority() const
+    {
+      return m_priority;
+    }
 
   Q_SIGNALS:
-    void lookupFinished( KCDDB::Result, KCDDB::CDInfoList );
+    void lookupFinished( KCDDB::Result, KCDDB::CDInfoList, KCDDB::CDInfoList );
+
+  private:
+    DiscSignature m_signature;
+    MusicBrainzScheduler::Priority m_priority;
+    QUrl m_server;
+    QAtomicInt m_cancelled;
   };
 
   AsyncMusicBrainzLookup::AsyncMusicBrainzLookup()
+    : priority_(MusicBrainzScheduler::Interactive),
+      server_(QStringLiteral("https://musicbrainz.org"))
   {
-    // Register custom data types for the signal-slot connection with the lookup thread:
+    // Register custom data types for the signal-slot connection with the lookup task:
     qRegisterMetaType<KCDDB::Result>("KCDDB::Result");
     qRegisterMetaType<KCDDB::CDInfoList>("KCDDB::CDInfoList");
   }
 
   AsyncMusicBrainzLookup::~AsyncMusicBrainzLookup()
   {
-
+    cancel();
   }
 
-  Result AsyncMusicBrainzLookup::lookup( const QString &, uint, const TrackOffsetList & trackOffsetList )
+  Result AsyncMusicBrainzLookup::lookup( const QString &, uint, const DiscSignature & signature )
   {
-    LookupThread* lookupThread = new LookupThread();
-    lookupThread->m_offsetList = trackOffsetList;
-    connect(lookupThread, &LookupThread::lookupFinished, this, &AsyncMusicBrainzLookup::processLookupResult); // queued connection
+    cancel();
 
-    // Make the thread object "self-destructive"; allows us to keep the destructor non-blocking
-    connect(lookupThread, &LookupThread::finished, lookupThread, &LookupThread::deleteLater);
-    // NOTE: the memory automatically gets cleared after the thread has finished
+    LookupTask* task = new LookupTask(signature, priority_, server_);
+    connect(task, &LookupTask::lookupFinished, this, &AsyncMusicBrainzLookup::processLookupResult); // queued connection
+    task_ = task;
 
-    lookupThread->start();
+    s_lookupPools->pool(priority_)->start(task);
 
     return Success;
   }
 
-  void AsyncMusicBrainzLookup::processLookupResult( KCDDB::Result result, KCDDB::CDInfoList lookupResponse )
+  void AsyncMusicBrainzLookup::cancel()
+  {
+    if (!task_)
+      return;
+
+    disconnect(task_, nullptr, this, nullptr);
+
+    // A task that's already running stops before its next request, one
+    // that hasn't started skips the lookup
+    if (s_lookupPools->pool(task_->priority())->tryTake(task_))
+      delete task_;
+    else
+      task_->cancel();
+
+    task_ = nullptr;
+  }
+
+  void AsyncMusicBrainzLookup::setPriority( MusicBrainzScheduler::Priority priority )
+  {
+    priority_ = priority;
+  }
+
+  void AsyncMusicBrainzLookup::setServer( const QUrl &server )
+  {
+    server_ = server;
+  }
+
+  void AsyncMusicBrainzLookup::processLookupResult( KCDDB::Result result, KCDDB::CDInfoList lookupResponse, KCDDB::CDInfoList relatedResponse )
   {
     qDebug();
 
+    task_ = nullptr;
     cdInfoList_ = lookupResponse;
+    relatedInfoList_ = relatedResponse;
 
     Q_EMIT finished(result);
   }
@@ -8,10 +8,14 @@
 #define ASYNCMUSICBRAINZLOOKUP_H
 
 #include "lookup.h"
+#include "musicbrainzscheduler.h"
+
+#include <QPointer>
+#include <QUrl>
 
 namespace KCDDB
 {
-  class LookupThread;
+  class LookupTask;
 
   class AsyncMusicBrainzLookup : public Lookup
   {
@@ -22,15 +26,28 @@ namespace KCDDB
       AsyncMusicBrainzLookup();
       virtual ~AsyncMusicBrainzLookup();
 
-      Result lookup( const QString &, uint, const TrackOffsetList & ) override;
+      Result lookup( const QString &, uint, const DiscSignature & ) override;
 
       CDInfoList lookupResponse() const;
 
+      void setPriority( MusicBrainzScheduler::Priority );
+      void setServer( const QUrl & );
+
     Q_SIGNALS:
       void finished( KCDDB::Result );
 
     protected Q_SLOTS:
-      void processLookupResult( KCDDB::Result result, KCDDB::CDInfoList lookupResponse );
+      void processLookupResult( KCDDB::Result result, KCDDB::CDInfoList lookupResponse, KCDDB::CDInfoList relatedResponse );
+
+    private:
+      /**
+       * Drops the lookup in progress, if any
+       */
+      void cancel();
+
+      MusicBrainzScheduler::Priority priority_;
+      QUrl server_;
+      QPointer<LookupTask> task_;
   };
 }
 
@@ -0,0 +1,643 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "musicbrainzjson.h"
+
+#include "kcddbi18n.h"
+
+#include <QRegularExpression>
+#include <QStringList>
+#include <QVector>
+
+namespace KCDDB
+{
+  namespace
+  {
+    /**
+     * Walks a JSON text one value at a time. Containers are entered with
+     * enterObject() or enterArray() and then iterated with nextMember() or
+     * nextElement(), values that aren't needed have to be skip()ped.
+     * Any syntax error moves to the end of the text and sets failed().
+     */
+    class JsonCursor
+    {
+      public:
+        explicit JsonCursor( const QByteArray &json )
+          : pos_( json.constData() ), end_( json.constData() + json.size() ), failed_( false )
+        {}
+
+          bool
+        failed() const
+        {
+          return failed_;
+        }
+
+        /**
+         * Enters the next value if it's an object, skips it otherwise
+         */
+          bool
+        enterObject()
+        {
+          return enter( '{' );
+        }
+
+          bool
+        enterArray()
+        {
+          return enter( '[' );
+        }
+
+        /**
+         * Moves to the value of the next member of the current object
+         * @return false at the end of the object
+         */
+          bool
+        nextMember( QByteArray &key )
+        {
+          if ( !next( '}' ) )
+            return false;
+
+          if ( *pos_ != '"' )
+          {
+            fail();
+            return false;
+          }
+
+          // Keys are compared as they are, the ones we look for have
+          // nothing to unescape
+          const char *begin = pos_ + 1;
+          skipString();
+          if ( failed_ )
+            return false;
+
+          key = QByteArray::fromRawData( begin, pos_ - 1 - begin );
+
+          skipSpace();
+          if ( pos_ == end_ || *pos_ != ':' )
+          {
+            fail();
+            return false;
+          }
+
+          ++pos_;
+          return true;
+        }
+
+        /**
+         * Moves to the next element of the current array
+         * @return false at the end of the array
+         */
+          bool
+        nextElement()
+        {
+          return next( ']' );
+        }
+
+        /**
+         * @return the next value if it's a string, a null string otherwise
+         */
+          QString
+        readString()
+        {
+          skipSpace();
+          if ( pos_ == end_ || *pos_ != '"' )
+          {
+            skip();
+            return QString();
+          }
+
+          const char *begin = ++pos_;
+          while ( pos_ != end_ && *pos_ != '"' && *pos_ != '\\' )
+            ++pos_;
+
+          // Most strings have nothing to unescape
+          if ( pos_ != end_ && *pos_ == '"' )
+            return QString::fromUtf8( begin, pos_++ - begin );
+
+          QString result = QString::fromUtf8( begin, pos_ - begin );
+
+          while ( pos_ != end_ )
+          {
+            const char *run = pos_;
+            while ( pos_ != end_ && *pos_ != '"' && *pos_ != '\\' )
+              ++pos_;
+            result += QString::fromUtf8( run, pos_ - run );
+
+            if ( pos_ == end_ )
+              break;
+
+            if ( *pos_ == '"' )
+            {
+              ++pos_;
+              return result;
+            }
+
+            if ( end_ - pos_ < 2 )
+              break;
+
+            const char escaped = pos_[ 1 ];
+            pos_ += 2;
+
+            switch ( escaped )
+            {
+              case 'b': result += QLatin1Char( '\b' ); break;
+              case 'f': result += QLatin1Char( '\f' ); break;
+              case 'n': result += QLatin1Char( '\n' ); break;
+              case 'r': result += QLatin1Char( '\r' ); break;
+              case 't': result += QLatin1Char( '\t' ); break;
+              case 'u':
+              {
+                // Surrogate pairs come as two escapes and end up as two
+                // UTF-16 code units, just as they should
+                ushort unit = 0;
+                for ( int i = 0; i < 4; ++i, ++pos_ )
+                {
+                  const int digit = pos_ == end_ ? -1 : hexDigit( *pos_ );
+                  if ( digit < 0 )
+                  {
+                    fail();
+                    return QString();
+                  }
+                  unit = unit * 16 + digit;
+                }
+                result += QChar( unit );
+                break;
+              }
+              default:
+                result += QLatin1Char( escaped );
+            }
+          }
+
+          fail();
+          return QString();
+        }
+
+        /**
+         * @return the next value if it's an integer, 0 otherwise
+         */
+          int
+        readInt()
+        {
+          skipSpace();
+          const char *begin = pos_;
+          skip();
+
+          return QByteArray( begin, pos_ - begin ).toInt();
+        }
+
+          void
+        skip()
+        {
+          skipSpace();
+          if ( pos_ == end_ )
+          {
+            fail();
+            return;
+          }
+
+          if ( *pos_ == '"' )
+          {
+            skipString();
+            return;
+          }
+
+          if ( *pos_ == '{' || *pos_ == '[' )
+          {
+            int depth = 0;
+            while ( pos_ != end_ )
+            {
+              const char c = *pos_;
+              if ( c == '"' )
+              {
+                skipString();
+                continue;
+              }
+
+              ++pos_;
+              if ( c == '{' || c == '[' )
+                ++depth;
+              else if ( ( c == '}' || c == ']' ) && 0 == --depth )
+                return;
+            }
+
+            fail();
+            return;
+          }
+
+          // Numbers, true, false and null
+          const char *begin = pos_;
+          while ( pos_ != end_ && *pos_ != ',' && *pos_ != '}' && *pos_ != ']' && !isSpace( *pos_ ) )
+            ++pos_;
+
+          if ( pos_ == begin )
+            fail();
+        }
+
+      private:
+          static bool
+        isSpace( char c )
+        {
+          return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+          static int
+        hexDigit( char c )
+        {
+          if ( c >= '0' && c <= '9' )
+            return c - '0';
+          if ( c >= 'a' && c <= 'f' )
+            return c - 'a' + 10;
+          if ( c >= 'A' && c <= 'F' )
+            return c - 'A' + 10;
+          return -1;
+        }
+
+          void
+        fail()
+        {
+          failed_ = true;
+          pos_ = end_;
+        }
+
+          void
+        skipSpace()
+        {
+          while ( pos_ != end_ && isSpace( *pos_ ) )
+            ++pos_;
+        }
+
+        // Skips the string starting at pos_, including its quotes
+          void
+        skipString()
+        {
+          for ( ++pos_; pos_ != end_; ++pos_ )
+          {
+            if ( *pos_ == '\\' )
+            {
+              if ( end_ - pos_ < 2 )
+                break;
+              ++pos_;
+            }
+            else if ( *pos_ == '"' )
+            {
+              ++pos_;
+              return;
+            }
+          }
+
+          fail();
+        }
+
+          bool
+        enter( char open )
+        {
+          skipSpace();
+          if ( pos_ != end_ && *pos_ == open )
+          {
+            ++pos_;
+            return true;
+          }
+
+          skip();
+          return false;
+        }
+
+          bool
+        next( char close )
+        {
+          skipSpace();
+          if ( pos_ != end_ && *pos_ == ',' )
+          {
+            ++pos_;
+            skipSpace();
+          }
+
+          if ( pos_ == end_ )
+          {
+            fail();
+            return false;
+          }
+
+          if ( *pos_ == close )
+          {
+            ++pos_;
+            return false;
+          }
+
+          return true;
+        }
+
+        const char *pos_;
+        const char *end_;
+        bool failed_;
+    };
+
+    class Track
+    {
+      public:
+        Track()
+          : hasArtist( false ), hasRecording( false )
+        {}
+
+        QString title;
+        QString artist;
+        bool hasArtist;
+        bool hasRecording;
+        QString recordingTitle;
+        QString recordingArtist;
+    };
+
+    class Medium
+    {
+      public:
+        Medium()
+          : position( 0 ), hasDisc( false ), hasTracks( false )
+        {}
+
+        int position;
+        bool hasDisc;
+        bool hasTracks;
+        QStringList discIds;
+        QVector<Track> tracks;
+    };
+
+    // The names of an artist-credit array, joined as they're credited
+      QString
+    readArtistCredit( JsonCursor &json )
+    {
+      QString artist;
+      QByteArray key;
+
+      if ( !json.enterArray() )
+        return artist;
+
+      while ( json.nextElement() )
+      {
+        QString name;
+        QString artistName;
+        QString joinPhrase;
+
+        if ( !json.enterObject() )
+          continue;
+
+        while ( json.nextMember( key ) )
+        {
+          if ( key == "name" )
+            name = json.readString();
+          else if ( key == "joinphrase" )
+            joinPhrase = json.readString();
+          else if ( key == "artist" && json.enterObject() )
+          {
+            while ( json.nextMember( key ) )
+            {
+              if ( key == "name" )
+                artistName = json.readString();
+              else
+                json.skip();
+            }
+          }
+          else if ( key != "artist" )
+            json.skip();
+        }
+
+        artist += name.isEmpty() ? artistName : name;
+        artist += joinPhrase;
+      }
+
+      return artist;
+    }
+
+      Track
+    readTrack( JsonCursor &json )
+    {
+      Track track;
+      QByteArray key;
+
+      if ( !json.enterObject() )
+        return track;
+
+      while ( json.nextMember( key ) )
+      {
+        if ( key == "title" )
+          track.title = json.readString();
+        else if ( key == "artist-credit" )
+        {
+          track.artist = readArtistCredit( json );
+          track.hasArtist = true;
+        }
+        else if ( key == "recording" && json.enterObject() )
+        {
+          track.hasRecording = true;
+
+          while ( json.nextMember( key ) )
+          {
+            if ( key == "title" )
+              track.recordingTitle = json.readString();
+            else if ( key == "artist-credit" )
+              track.recordingArtist = readArtistCredit( json );
+            else
+              json.skip();
+          }
+        }
+        else if ( key != "recording" )
+          json.skip();
+      }
+
+      return track;
+    }
+
+      Medium
+    readMedium( JsonCursor &json, const QString &discId )
+    {
+      Medium medium;
+      QByteArray key;
+
+      if ( !json.enterObject() )
+        return medium;
+
+      while ( json.nextMember( key ) )
+      {
+        if ( key == "position" )
+          medium.position = json.readInt();
+        else if ( key == "discs" && json.enterArray() )
+        {
+          while ( json.nextElement() )
+          {
+            if ( !json.enterObject() )
+              continue;
+
+            while ( json.nextMember( key ) )
+            {
+              if ( key == "id" )
+              {
+                const QString id = json.readString();
+                if ( id == discId )
+                  medium.hasDisc = true;
+                else if ( !id.isEmpty() )
+                  medium.discIds << id;
+              }
+              else
+                json.skip();
+            }
+          }
+        }
+        else if ( key == "tracks" && json.enterArray() )
+        {
+          medium.hasTracks = true;
+
+          while ( json.nextElement() )
+            medium.tracks.append( readTrack( json ) );
+        }
+        else if ( key != "discs" && key != "tracks" )
+          json.skip();
+      }
+
+      return medium;
+    }
+
+      int
+    yearFromDate( const QString &date )
+    {
+      static const QRegularExpression yearRe( QStringLiteral( "^(\\d{4,4})(-\\d{1,2}-\\d{1,2})?$" ) );
+
+      const QRegularExpressionMatch match = yearRe.match( date );
+      return match.hasMatch() ? match.captured( 1 ).toInt() : 0;
+    }
+
+      MusicBrainzJson::Release
+    readReleaseObject( JsonCursor &json, const QString &discId )
+    {
+      MusicBrainzJson::Release release;
+      QString title;
+      QString artist;
+      QString date;
+      QVector<Medium> media;
+      int mediaCount = 0;
+      QByteArray key;
+
+      if ( !json.enterObject() )
+        return release;
+
+      while ( json.nextMember( key ) )
+      {
+        if ( key == "id" )
+          release.id = json.readString();
+        else if ( key == "title" )
+          title = json.readString();
+        else if ( key == "date" )
+          date = json.readString();
+        else if ( key == "artist-credit" )
+          artist = readArtistCredit( json );
+        else if ( key == "media-count" )
+          mediaCount = json.readInt();
+        else if ( key == "media" && json.enterArray() )
+        {
+          while ( json.nextElement() )
+            media.append( readMedium( json, discId ) );
+        }
+        else if ( key != "media" )
+          json.skip();
+      }
+
+      release.complete = true;
+
+      // The media of a disc id lookup can be only the ones with the disc
+      if ( mediaCount <= 0 )
+        mediaCount = media.count();
+
+      for ( const Medium &medium : qAsConst( media ) )
+      {
+        if ( !medium.hasTracks )
+        {
+          if ( medium.hasDisc )
+            release.complete = false;
+          continue;
+        }
+
+        CDInfo info;
+        info.set( QLatin1String( "source" ), QLatin1String( "musicbrainz" ) );
+
+        if ( mediaCount > 1 )
+          info.set( Title, i18n( "%1 (disc %2)", title, medium.position ) );
+        else
+          info.set( Title, title );
+
+        info.set( Artist, artist );
+        info.set( Year, yearFromDate( date ) );
+
+        for ( int i = 0; i < medium.tracks.count(); ++i )
+        {
+          const Track &t = medium.tracks.at( i );
+          TrackInfo &track = info.track( i );
+
+          // Same preference as with libmusicbrainz, see MusicBrainzLookup
+          if ( t.hasRecording && !t.hasArtist )
+            track.set( Artist, t.recordingArtist );
+          else
+            track.set( Artist, t.artist );
+
+          if ( t.hasRecording && t.title.isEmpty() )
+            track.set( Title, t.recordingTitle );
+          else
+            track.set( Title, t.title );
+        }
+
+        if ( medium.hasDisc )
+        {
+          release.media << info;
+          // Like libmusicbrainz, which skips media containing the disc
+          continue;
+        }
+
+        for ( const QString &id : medium.discIds )
+        {
+          info.set( QLatin1String( "discid" ), id );
+          release.otherMedia << info;
+        }
+      }
+
+      if ( release.media.isEmpty() )
+        release.complete = false;
+
+      return release;
+    }
+  }
+
+    bool
+  MusicBrainzJson::readDisc( const QByteArray &json, const QString &discId, QList<Release> &releases )
+  {
+    JsonCursor cursor( json );
+    QByteArray key;
+
+    if ( !cursor.enterObject() )
+      return false;
+
+    while ( cursor.nextMember( key ) )
+    {
+      if ( key == "releases" && cursor.enterArray() )
+      {
+        while ( cursor.nextElement() )
+          releases << readReleaseObject( cursor, discId );
+      }
+      else if ( key != "releases" )
+        cursor.skip();
+    }
+
+    return !cursor.failed();
+  }
+
+    bool
+  MusicBrainzJson::readRelease( const QByteArray &json, const QString &discId, Release &release )
+  {
+    JsonCursor cursor( json );
+
+    release = readReleaseObject( cursor, discId );
+
+    return !cursor.failed();
+  }
+}
+
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCDDB_MUSICBRAINZJSON_H
+#define KCDDB_MUSICBRAINZJSON_H
+
+#include "kcddb_tests_export.h"
+#include "../cdinfo.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+namespace KCDDB
+{
+  /**
+   * Reads responses of the MusicBrainz JSON web service into CDInfos.
+   *
+   * The JSON is walked once without building a document. Only the fields
+   * that end up in a CDInfo are turned into strings, everything else is
+   * skipped over.
+   */
+  class KCDDB_TESTS_EXPORT MusicBrainzJson
+  {
+    public:
+      /**
+       * One release of a disc
+       */
+      class Release
+      {
+        public:
+          Release()
+            : complete( false )
+          {}
+
+          QString id;
+          /**
+           * A CDInfo for each medium of the release with the disc on it,
+           * without a discid
+           */
+          CDInfoList media;
+          /**
+           * false if the response left out those media or their tracks,
+           * the release needs to be queried on its own then
+           */
+          bool complete;
+          /**
+           * A CDInfo for each of the other discs of the release, with the
+           * id of the disc as discid. A medium with several discs on it
+           * comes once for each of them, unless it has the looked up disc
+           * as well, like with libmusicbrainz.
+           */
+          CDInfoList otherMedia;
+      };
+
+      /**
+       * Reads the releases from the response to a discid query for
+       * @p discId
+       * @return false if @p json isn't valid
+       */
+      static bool readDisc( const QByteArray &json, const QString &discId, QList<Release> &releases );
+
+      /**
+       * Reads the response to a release query
+       * @return false if @p json isn't valid
+       */
+      static bool readRelease( const QByteArray &json, const QString &discId, Release &release );
+  };
+}
+
+#endif // KCDDB_MUSICBRAINZJSON_H
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -7,7 +7,10 @@
 #include "musicbrainzlookup.h"
 
 #include "kcddbi18n.h"
+#include "musicbrainzscheduler.h"
+#include "../cacheindex.h"
 
+#ifdef HAVE_MUSICBRAINZ5
 #include <musicbrainz5/Query.h>
 #include <musicbrainz5/Medium.h>
 #include <musicbrainz5/Release.h>
@@ -20,17 +23,113 @@
 #include <musicbrainz5/Artist.h>
 #include <musicbrainz5/NameCredit.h>
 #include <musicbrainz5/SecondaryType.h>
+#else
+#include "musicbrainzjson.h"
+#include "../synchttpclient.h"
+
+#include <QUrlQuery>
+#endif
 
-#include <QCryptographicHash>
 #include <QDebug>
 #include <QRegularExpression>
 
-#include <cstdio>
-#include <cstring>
-
 namespace KCDDB
 {
+  namespace
+  {
+    // How often a request is retried when the server is overloaded
+    const int maxRetries = 4;
+
+#ifdef HAVE_MUSICBRAINZ5
+    // Thrown by query() when the lookup is cancelled while it waits
+    class Cancelled
+    {
+    };
+
+    /**
+     * Sends a request once the scheduler allows it, retrying it while the
+     * server answers with 503
+     */
+    MusicBrainz5::CMetadata query(MusicBrainz5::CQuery &Query, const std::string &Entity,
+        const std::string &ID, const MusicBrainz5::CQuery::tParamMap &Params,
+        MusicBrainzScheduler::Priority priority, const QAtomicInt *cancelled)
+    {
+      for (int attempt = 0; ; attempt++)
+      {
+        if (!MusicBrainzScheduler::acquire(priority, cancelled))
+          throw Cancelled();
+
+        try
+        {
+          MusicBrainz5::CMetadata Metadata = Query.Query(Entity, ID, "", Params);
+          MusicBrainzScheduler::reportSuccess();
+          return Metadata;
+        }
+        catch (MusicBrainz5::CExceptionBase&)
+        {
+          if (Query.LastHTTPCode() != 503 || attempt == maxRetries)
+            throw;
+
+          MusicBrainzScheduler::reportThrottled();
+        }
+      }
+    }
+#else
+    /**
+     * Fetches @p path below the web service at @p server once the
+     * scheduler allows it, retrying it while the server answers with 503
+     * @return NoResponse if the lookup was cancelled while it waited
+     */
+    Result fetch(const QUrl &server, const QString &path, const QString &inc,
+        MusicBrainzScheduler::Priority priority, const QAtomicInt *cancelled, QByteArray &data)
+    {
+      QUrl url = server;
+      QString base = url.path();
+      if (!base.endsWith(QLatin1Char('/')))
+        base += QLatin1Char('/');
+      url.setPath(base + QLatin1String("ws/2/") + path);
+
+      QUrlQuery query;
+      query.addQueryItem(QLatin1String("inc"), inc);
+      query.addQueryItem(QLatin1String("fmt"), QLatin1String("json"));
+      url.setQuery(query);
+
+      for (int attempt = 0; ; attempt++)
+      {
+        if (!MusicBrainzScheduler::acquire(priority, cancelled))
+          return NoResponse;
+
+        int status;
+        if (SyncHTTPClient::get(url, data, &status))
+        {
+          MusicBrainzScheduler::reportSuccess();
+          return Success;
+        }
+
+        if (status == 503 && attempt < maxRetries)
+        {
+          MusicBrainzScheduler::reportThrottled();
+          continue;
+        }
+
+        qDebug() << "Fetching " << url << " failed with status " << status;
+
+        if (status == 404)
+        {
+          MusicBrainzScheduler::reportSuccess();
+          return NoRecordFound;
+        }
+
+        return ServerError;
+      }
+    }
+#endif
+  }
+
   MusicBrainzLookup::MusicBrainzLookup()
+    : priority_(MusicBrainzScheduler::Interactive),
+      server_(QStringLiteral("https://musicbrainz.org")),
+      cancelled_(nullptr)
   {
 
   }
@@ -40,18 +139,24 @@ namespace KCDDB
 
   }
 
-  Result MusicBrainzLookup::lookup( const QString &, uint, const TrackOffsetList & trackOffsetList )
+#ifdef HAVE_MUSICBRAINZ5
+  Result MusicBrainzLookup::lookup( const QString &, uint, const DiscSignature & signature )
   {
-    QString discId = calculateDiscId(trackOffsetList);
+    QString discId = signature.musicBrainzId();
 
     qDebug() << "Should lookup " << discId;
 
-    MusicBrainz5::CQuery Query("libkcddb-0.5");
+    MusicBrainz5::CQuery Query("libkcddb-0.5", server_.host().toStdString(), server_.port(80));
 
     // Code adapted from libmusicbrainz/examples/cdlookup.cc
 
     try {
-      MusicBrainz5::CMetadata Metadata=Query.Query("discid",discId.toLatin1().constData());
+      // Ask for the tracks and credits right away, so most discs only need
+      // this one request instead of another one for each release
+      MusicBrainz5::CQuery::tParamMap Params;
+      Params["inc"]="artists labels recordings release-groups artist-credits discids";
+
+      MusicBrainz5::CMetadata Metadata=query(Query,"discid",discId.toLatin1().constData(),Params,priority_,cancelled_);
 
       if (Metadata.Disc() && Metadata.Disc()->ReleaseList())
       {
@@ -64,105 +169,28 @@ namespace KCDDB
         {
           MusicBrainz5::CRelease* Release=ReleaseList->Item(i);
 
-          //The releases returned from LookupDiscID don't contain full information
+          if (addRelease(Release, discId, relnr))
+            continue;
 
-          MusicBrainz5::CQuery::tParamMap Params;
-          Params["inc"]="artists labels recordings release-groups url-rels discids artist-credits";
+          // The release came without the media we need, fall back to
+          // querying it on its own
+          MusicBrainz5::CQuery::tParamMap ReleaseParams;
+          ReleaseParams["inc"]="artists labels recordings release-groups url-rels discids artist-credits";
 
-          std::string ReleaseID=Release->ID();
-
-          MusicBrainz5::CMetadata Metadata2=Query.Query("release",ReleaseID,"",Params);
+          MusicBrainz5::CMetadata Metadata2=query(Query,"release",Release->ID(),ReleaseParams,priority_,cancelled_);
           if (Metadata2.Release())
-          {
-            MusicBrainz5::CRelease *FullRelease=Metadata2.Release();
-
-            //However, these releases will include information for all media in the release
-            //So we need to filter out the only the media we want.
-
-            MusicBrainz5::CMediumList MediaList=FullRelease->MediaMatchingDiscID(discId.toLatin1().constData());
-
-            if (MediaList.NumItems() > 0)
-            {
-              /*if (FullRelease->ReleaseGroup())
-                qDebug() << "Release group title: " << FullRelease->ReleaseGroup()->Title();
-              else
-                qDebug() << "No release group for this release";*/
-
-              qDebug() << "Found " << MediaList.NumItems() << " media item(s)";
-
-              for (int i=0; i < MediaList.NumItems(); i++)
-              {
-                MusicBrainz5::CMedium* Medium= MediaList.Item(i);
-
-                /*qDebug() << "Found media: '" << Medium.Title() << "', position " << Medium.Position();*/
-
-                CDInfo info;
-                info.set(QLatin1String( "source" ), QLatin1String( "musicbrainz" ));
-                // Uses musicbrainz discid for the first release,
-                // then discid-2, discid-3 and so on, to
-                // allow multiple releases with the same discid
-                if (relnr == 1)
-                  info.set(QLatin1String( "discid" ), discId);
-                else
-                  info.set(QLatin1String( "discid" ), QVariant(discId+QLatin1String( "-" )+QString::number(relnr)));
-
-                QString title = QString::fromUtf8(FullRelease->Title().c_str());
-
-                if (FullRelease->MediumList()->NumItems() > 1)
-                  title = i18n("%1 (disc %2)", title, Medium->Position());
-
-                info.set(Title, title);
-                info.set(Artist, artistFromCreditList(FullRelease->ArtistCredit()));
-
-                QString date = QString::fromUtf8(FullRelease->Date().c_str());
-                const QRegularExpression yearRe(QString::fromUtf8("^(\\d{4,4})(-\\d{1,2}-\\d{1,2})?$"));
-                int year = 0;
-                if (const auto yearMatch = yearRe.match(date); yearMatch.hasMatch())
-                {
-                  QString yearString = yearMatch.captured(1);
-                  bool ok;
-                  year=yearString.toInt(&ok);
-                  if (!ok)
-                    year = 0;
-                }
-                info.set(Year, year);
-
-                MusicBrainz5::CTrackList *TrackList=Medium->TrackList();
-                if (TrackList)
-                {
-                  for (int i=0; i < TrackList->NumItems(); i++)
-                  {
-                    MusicBrainz5::CTrack* Track=TrackList->Item(i);
-                    MusicBrainz5::CRecording *Recording=Track->Recording();
-
-                    TrackInfo& track = info.track(i);
-
-                    // Prefer title and artist from the track credits, but
-                    // it appears to be empty if same as in Recording
-                    // Noticeable in the musicbrainztest-fulldate test,
-                    // where the title on the credits of track 18 are
-                    // "Bara om min älskade väntar", but the recording
-                    // has title "Men bara om min älskade"
-                    if(Recording && Track->ArtistCredit() == nullptr)
-                      track.set(Artist, artistFromCreditList(Recording->ArtistCredit()));
-                    else
-                      track.set(Artist, artistFromCreditList(Track->ArtistCredit()));
-
-                    if(Recording && Track->Title().empty())
-                      track.set(Title, QString::fromUtf8(Recording->Title().c_str()));
-                    else
-                      track.set(Title, QString::fromUtf8(Track->Title().c_str()));
-                  }
-                }
-                cdInfoList_ << info;
-                relnr++;
-              }
-            }
-          }
+            addRelease(Metadata2.Release(), discId, relnr);
         }
       }
     }
 
+    catch (Cancelled&)
+    {
+      qDebug() << "Cancelled";
+
+      return NoResponse;
+    }
+
     catch (MusicBrainz5::CConnectionError& Error)
     {
       qDebug() << "Connection Exception: '" << Error.what() << "'";
@@ -234,64 +262,229 @@ namespace KCDDB
     return Success;
   }
 
-  QString MusicBrainzLookup::calculateDiscId(const TrackOffsetList & trackOffsetList )
+#else
+  Result MusicBrainzLookup::lookup( const QString &, uint, const DiscSignature & signature )
   {
-    // Code based on libmusicbrainz/lib/diskid.cpp
+    const QString discId = signature.musicBrainzId();
 
-    int numTracks = trackOffsetList.count()-1;
+    qDebug() << "Should lookup " << discId;
 
-    QCryptographicHash sha(QCryptographicHash::Sha1);
-    char           temp[9];
+    // Tracks and credits come along with the releases, so most discs only
+    // need this one request
+    QByteArray data;
+    Result result = fetch(server_, QLatin1String("discid/") + discId,
+        QLatin1String("recordings+artist-credits+discids"), priority_, cancelled_, data);
+    if (result != Success)
+      return result;
 
-    // FIXME How do I check that?
-    int firstTrack = 1;
-    int lastTrack = numTracks;
+    QList<MusicBrainzJson::Release> releases;
+    if (!MusicBrainzJson::readDisc(data, discId, releases))
+    {
+      qDebug() << "Invalid response";
+      return ServerError;
+    }
 
-    sprintf(temp, "%02X", firstTrack);
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    sha.addData(QByteArrayView(temp, strlen(temp)));
-#else
-    sha.addData(temp, strlen(temp));
-#endif
+    qDebug() << "Found " << releases.count() << " release(s)";
 
-    sprintf(temp, "%02X", lastTrack);
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    sha.addData(QByteArrayView(temp, strlen(temp)));
-#else
-    sha.addData(temp, strlen(temp));
+    int relnr=1;
+    bool failed = false;
+
+    for (MusicBrainzJson::Release &release : releases)
+    {
+      if (!release.complete && !release.id.isEmpty())
+      {
+        // The release came without the media we need, fall back to
+        // querying it on its own
+        result = fetch(server_, QLatin1String("release/") + release.id,
+            QLatin1String("recordings+artist-credits+discids"), priority_, cancelled_, data);
+        if (result == NoResponse)
+          return result;
+
+        if (result == ServerError)
+        {
+          // The other releases may still know the disc
+          qDebug() << "Couldn't fetch release " << release.id;
+          failed = true;
+          continue;
+        }
+
+        if (result == Success && !MusicBrainzJson::readRelease(data, discId, release))
+          qDebug() << "Invalid response for release " << release.id;
+      }
+
+      for (CDInfo &info : release.media)
+      {
+        // Uses musicbrainz discid for the first release,
+        // then discid-2, discid-3 and so on, to
+        // allow multiple releases with the same discid
+        if (relnr == 1)
+          info.set(QLatin1String( "discid" ), discId);
+        else
+          info.set(QLatin1String( "discid" ), QVariant(discId+QLatin1String( "-" )+QString::number(relnr)));
+
+        cdInfoList_ << info;
+        relnr++;
+      }
+
+      // The other discs of the release came along, keep them for the cache
+      for (const CDInfo &info : qAsConst(release.otherMedia))
+        addRelated(info.get(QLatin1String( "discid" )).toString(), info);
+    }
+
+    if (cdInfoList_.isEmpty())
+    {
+        if (failed)
+          return ServerError;
+
+        qDebug() << "No record found";
+        return NoRecordFound;
+    }
+
+    qDebug() << "Query succeeded :-)";
+
+    return Success;
+  }
 #endif
 
-    for(int i = 0; i < 100; i++)
+  void MusicBrainzLookup::setPriority(MusicBrainzScheduler::Priority priority)
+  {
+    priority_ = priority;
+  }
+
+  void MusicBrainzLookup::setServer(const QUrl &server)
+  {
+    server_ = server;
+  }
+
+  void MusicBrainzLookup::setCancelFlag(const QAtomicInt *cancelled)
+  {
+    cancelled_ = cancelled;
+  }
+
+#ifdef HAVE_MUSICBRAINZ5
+  bool MusicBrainzLookup::addRelease(MusicBrainz5::CRelease *Release, const QString &discId, int &relnr)
+  {
+    // Releases include all of their media, so filter out the ones we want
+    MusicBrainz5::CMediumList MediaList=Release->MediaMatchingDiscID(discId.toLatin1().constData());
+
+    if (MediaList.NumItems() == 0)
+      return false;
+
+    for (int i=0; i < MediaList.NumItems(); i++)
+    {
+      if (!MediaList.Item(i)->TrackList())
+        return false;
+    }
+
+    qDebug() << "Found " << MediaList.NumItems() << " media item(s)";
+
+    for (int i=0; i < MediaList.NumItems(); i++)
     {
-      long offset;
-      if (i == 0)
-        offset = trackOffsetList[numTracks];
-      else if (i <= numTracks)
-        offset = trackOffsetList[i-1];
+      CDInfo info = mediumInfo(Release, MediaList.Item(i));
+
+      // Uses musicbrainz discid for the first release,
+      // then discid-2, discid-3 and so on, to
+      // allow multiple releases with the same discid
+      if (relnr == 1)
+        info.set(QLatin1String( "discid" ), discId);
       else
-        offset = 0;
+        info.set(QLatin1String( "discid" ), QVariant(discId+QLatin1String( "-" )+QString::number(relnr)));
 
-      sprintf(temp, "%08lX", offset);
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-      sha.addData(QByteArrayView(temp, strlen(temp)));
-#else
-      sha.addData(temp, strlen(temp));
-#endif
+      cdInfoList_ << info;
+      relnr++;
+    }
+
+    // The other discs of the release came along, keep them for the cache
+    MusicBrainz5::CMediumList *AllMedia=Release->MediumList();
+    for (int i=0; AllMedia && i < AllMedia->NumItems(); i++)
+    {
+      MusicBrainz5::CMedium* Medium=AllMedia->Item(i);
+
+      if (Medium->ContainsDiscID(discId.toLatin1().constData()) || !Medium->TrackList() || !Medium->DiscList())
+        continue;
+
+      const CDInfo info = mediumInfo(Release, Medium);
+
+      for (int j=0; j < Medium->DiscList()->NumItems(); j++)
+        addRelated(QString::fromUtf8(Medium->DiscList()->Item(j)->ID().c_str()), info);
     }
 
-    QByteArray base64 = sha.result().toBase64();
+    return true;
+  }
+
+  CDInfo MusicBrainzLookup::mediumInfo(MusicBrainz5::CRelease *Release, MusicBrainz5::CMedium *Medium)
+  {
+    CDInfo info;
+    info.set(QLatin1String( "source" ), QLatin1String( "musicbrainz" ));
+
+    QString title = QString::fromUtf8(Release->Title().c_str());
+
+    if (Release->MediumList()->Count() > 1 || Release->MediumList()->NumItems() > 1)
+      title = i18n("%1 (disc %2)", title, Medium->Position());
+
+    info.set(Title, title);
+    info.set(Artist, artistFromCreditList(Release->ArtistCredit()));
 
-    // '/' '+' and '=' replaced for MusicBrainz
-    QString res = QString::fromLatin1(base64).replace(QLatin1Char( '/' ),QLatin1String( "_" )).replace(QLatin1Char( '+' ),QLatin1String( "." )).replace(QLatin1Char( '=' ),QLatin1String( "-" ));
+    QString date = QString::fromUtf8(Release->Date().c_str());
+    const QRegularExpression yearRe(QString::fromUtf8("^(\\d{4,4})(-\\d{1,2}-\\d{1,2})?$"));
+    int year = 0;
+    if (const auto yearMatch = yearRe.match(date); yearMatch.hasMatch())
+    {
+      QString yearString = yearMatch.captured(1);
+      bool ok;
+      year=yearString.toInt(&ok);
+      if (!ok)
+        year = 0;
+    }
+    info.set(Year, year);
+
+    MusicBrainz5::CTrackList *TrackList=Medium->TrackList();
+    for (int j=0; j < TrackList->NumItems(); j++)
+    {
+      MusicBrainz5::CTrack* Track=TrackList->Item(j);
+      MusicBrainz5::CRecording *Recording=Track->Recording();
+
+      TrackInfo& track = info.track(j);
+
+      // Prefer title and artist from the track credits, but
+      // it appears to be empty if same as in Recording
+      // Noticeable in the musicbrainztest-fulldate test,
+      // where the title on the credits of track 18 are
+      // "Bara om min älskade väntar", but the recording
+      // has title "Men bara om min älskade"
+      if(Recording && Track->ArtistCredit() == nullptr)
+        track.set(Artist, artistFromCreditList(Recording->ArtistCredit()));
+      else
+        track.set(Artist, artistFromCreditList(Track->ArtistCredit()));
+
+      if(Recording && Track->Title().empty())
+        track.set(Title, QString::fromUtf8(Recording->Title().c_str()));
+      else
+        track.set(Title, QString::fromUtf8(Track->Title().c_str()));
+    }
 
-    return res;
+    return info;
   }
+#endif
+
+  void MusicBrainzLookup::addRelated(const QString &discId, CDInfo info)
+  {
+    // Numbered like the results, in case several releases share the disc
+    const int number = ++relatedCount_[discId];
+
+    if (number == 1)
+      info.set(QLatin1String( "discid" ), discId);
+    else
+      info.set(QLatin1String( "discid" ), QVariant(discId+QLatin1String( "-" )+QString::number(number)));
 
-  CDInfoList MusicBrainzLookup::cacheFiles(const TrackOffsetList &offsetList, const Config& c )
+    relatedInfoList_ << info;
+  }
+
+  CDInfoList MusicBrainzLookup::cacheFiles(const DiscSignature &signature, const Config& c )
   {
     CDInfoList infoList;
     QStringList cddbCacheDirs = c.cacheLocations();
-    QString discid = calculateDiscId(offsetList);
+    QString discid = signature.musicBrainzId();
 
     for (QStringList::const_iterator cddbCacheDir = cddbCacheDirs.constBegin();
         cddbCacheDir != cddbCacheDirs.constEnd(); ++cddbCacheDir)
@@ -299,37 +492,48 @@ namespace KCDDB
       // Looks for all files in cddbdir/musicbrainz/discid*
       // Several files can correspond to the same discid,
       // then they are named discid, discid-2, discid-3 and so on
-      QDir dir(*cddbCacheDir+QLatin1String( "/musicbrainz/" ));
-      dir.setNameFilters(QStringList(discid+QLatin1String( "*" )));
+      QStringList files = CacheIndex::entries(*cddbCacheDir, discid);
 
-      QStringList files = dir.entryList();
-      qDebug() << "Cache files found: " << files.count();
-      for (QStringList::iterator it = files.begin(); it != files.end(); ++it)
+      // Entries the index doesn't know about, e.g. written by older
+      // versions or copied into the cache by hand
+      for (int probed = 0; probed < 2; ++probed)
       {
-        QFile f( dir.filePath(*it) );
-        if ( f.exists() && f.open(QIODevice::ReadOnly) )
+        if (probed)
+          files = CacheIndex::probe(*cddbCacheDir, discid);
+
+        files.sort();
+
+        qDebug() << "Cache files found: " << files.count();
+        bool found = false;
+        for (QStringList::iterator it = files.begin(); it != files.end(); ++it)
         {
-          QTextStream ts(&f);
-#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
-          ts.setCodec("UTF-8");
-#endif
-          QString cddbData = ts.readAll();
-          f.close();
-          CDInfo info;
-          info.load(cddbData);
-          info.set(QLatin1String( "source" ), QLatin1String( "musicbrainz" ));
-          info.set(QLatin1String( "discid" ), discid);
-
-          infoList.append( info );
+          if (!it->startsWith(QLatin1String( "musicbrainz/" )))
+            continue;
+
+          QByteArray cddbData;
+          if ( readCacheEntry(*cddbCacheDir, *it, cddbData) )
+          {
+            CDInfo info;
+            info.loadUtf8(cddbData);
+            info.set(QLatin1String( "source" ), QLatin1String( "musicbrainz" ));
+            info.set(QLatin1String( "discid" ), discid);
+
+            infoList.append( info );
+            found = true;
+          }
+          else
+            qDebug() << "Could not read cache entry: " << *it;
         }
-        else
-          qDebug() << "Could not read file: " << f.fileName();
+
+        if (found)
+          break;
       }
     }
 
     return infoList;
   }
 
+#ifdef HAVE_MUSICBRAINZ5
   QString MusicBrainzLookup::artistFromCreditList(MusicBrainz5::CArtistCredit * artistCredit )
   {
 	qDebug()/* << k_funcinfo*/;
@@ -358,6 +562,7 @@ namespace KCDDB
 
     return artistName;
   }
+#endif
 }
 
 #include "moc_musicbrainzlookup.cpp"
@@ -11,11 +11,21 @@
 #include "../cdinfo.h"
 #include "../kcddb.h"
 #include "../config.h"
+#include "musicbrainzscheduler.h"
 
+#include "config-musicbrainz.h"
+
+#include <QHash>
+#include <QUrl>
+
+#ifdef HAVE_MUSICBRAINZ5
 namespace MusicBrainz5
 {
   class CArtistCredit;
+  class CMedium;
+  class CRelease;
 }
+#endif
 
 namespace KCDDB
 {
@@ -29,14 +39,53 @@ namespace KCDDB
       virtual ~MusicBrainzLookup();
 
       // FIXME Only freedb lookup needs the first two arguments (host/port)
-      Result lookup( const QString &, uint, const TrackOffsetList & ) override;
+      Result lookup( const QString &, uint, const DiscSignature & ) override;
+
+      static CDInfoList cacheFiles(const DiscSignature &, const Config& );
+
+      /**
+       * Sets how the requests of this lookup are scheduled against those
+       * of other lookups, Interactive by default
+       */
+      void setPriority(MusicBrainzScheduler::Priority);
+
+      /**
+       * Sets the base URL of the web service, https://musicbrainz.org by
+       * default. libmusicbrainz only uses its host and port.
+       */
+      void setServer(const QUrl &);
 
-      static CDInfoList cacheFiles(const TrackOffsetList &, const Config& );
+      /**
+       * The lookup stops waiting for its next request and fails once
+       * @p cancelled is set, see MusicBrainzScheduler::wakeUp()
+       */
+      void setCancelFlag(const QAtomicInt *cancelled);
 
     private:
 
-      static QString calculateDiscId(const TrackOffsetList & );
+#ifdef HAVE_MUSICBRAINZ5
+      /**
+       * Adds a CDInfo for each medium of @p release with the disc on it
+       * @return false if the release doesn't include those media along
+       * with their tracks
+       */
+      bool addRelease(MusicBrainz5::CRelease *, const QString &discId, int &releaseNumber);
+
+      static CDInfo mediumInfo(MusicBrainz5::CRelease *, MusicBrainz5::CMedium *);
+
       static QString artistFromCreditList(MusicBrainz5::CArtistCredit * );
+#endif
+
+      /**
+       * Adds @p info, another disc of a release that was found, to the
+       * related response under @p discId
+       */
+      void addRelated(const QString &discId, CDInfo info);
+
+      MusicBrainzScheduler::Priority priority_;
+      QUrl server_;
+      const QAtomicInt *cancelled_;
+      QHash<QString, int> relatedCount_;
   } ;
 }
 
@@ -0,0 +1,200 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "musicbrainzscheduler.h"
+#include "../logging.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QWaitCondition>
+
+namespace KCDDB
+{
+  namespace
+  {
+    const int defaultInterval = 1000;
+    const int maximumBackoff = 60000;
+
+    class SchedulerState
+    {
+      public:
+        SchedulerState()
+          : interval( defaultInterval ), backoff( 0 ), nextSlot( 0 ),
+            requests( 0 ), throttled( 0 )
+        {
+          for ( int i = 0; i < 2; ++i )
+          {
+            waiting[ i ] = 0;
+            nextTicket[ i ] = 0;
+            nowServing[ i ] = 0;
+          }
+
+          clock.start();
+        }
+
+        QMutex mutex;
+        QWaitCondition condition;
+        QElapsedTimer clock;
+
+        int interval;
+        int backoff;
+        // When the next request may be sent, in ms on clock
+        qint64 nextSlot;
+
+        // Per priority, the number of waiting requests and the tickets
+        // that keep them in order
+        int waiting[ 2 ];
+        quint64 nextTicket[ 2 ];
+        quint64 nowServing[ 2 ];
+        // Tickets of cancelled requests that weren't served yet
+        QSet<quint64> abandoned[ 2 ];
+
+        quint64 requests;
+        quint64 throttled;
+    };
+
+    Q_GLOBAL_STATIC(SchedulerState, s_scheduler)
+
+    // Moves on to the next request of @p priority that is still waiting
+      void
+    serveNext( SchedulerState *s, MusicBrainzScheduler::Priority priority )
+    {
+      do
+        ++s->nowServing[ priority ];
+      while ( s->abandoned[ priority ].remove( s->nowServing[ priority ] ) );
+    }
+  }
+
+    bool
+  MusicBrainzScheduler::acquire( Priority priority, const QAtomicInt *cancelled )
+  {
+    SchedulerState *s = s_scheduler;
+    QMutexLocker locker( &s->mutex );
+
+    const quint64 ticket = s->nextTicket[ priority ]++;
+    ++s->waiting[ priority ];
+
+    for ( ;; )
+    {
+      if ( cancelled && cancelled->loadAcquire() )
+      {
+        --s->waiting[ priority ];
+
+        // The requests behind it mustn't wait for its turn
+        if ( s->nowServing[ priority ] == ticket )
+          serveNext( s, priority );
+        else
+          s->abandoned[ priority ].insert( ticket );
+
+        s->condition.wakeAll();
+        return false;
+      }
+
+      const bool turn = s->nowServing[ priority ] == ticket
+        && ( Interactive == priority || 0 == s->waiting[ Interactive ] );
+
+      if ( !turn )
+      {
+        s->condition.wait( &s->mutex );
+        continue;
+      }
+
+      const qint64 now = s->clock.elapsed();
+      if ( now >= s->nextSlot )
+      {
+        s->nextSlot = now + s->interval + s->backoff;
+        break;
+      }
+
+      // Woken early if an interactive request comes in, the delay changes
+      // or a request is cancelled
+      s->condition.wait( &s->mutex, s->nextSlot - now );
+    }
+
+    --s->waiting[ priority ];
+    serveNext( s, priority );
+    ++s->requests;
+
+    qCDebug(LIBKCDDB) << "MusicBrainz request, queued:" << s->waiting[ Interactive ]
+      << "interactive," << s->waiting[ Batch ] << "batch";
+
+    s->condition.wakeAll();
+
+    return true;
+  }
+
+    void
+  MusicBrainzScheduler::wakeUp()
+  {
+    SchedulerState *s = s_scheduler;
+    QMutexLocker locker( &s->mutex );
+
+    s->condition.wakeAll();
+  }
+
+    void
+  MusicBrainzScheduler::reportThrottled()
+  {
+    SchedulerState *s = s_scheduler;
+    QMutexLocker locker( &s->mutex );
+
+    ++s->throttled;
+    s->backoff = qBound( s->interval, 2 * s->backoff, maximumBackoff );
+    s->nextSlot = qMax( s->nextSlot, s->clock.elapsed() + s->backoff );
+
+    qCDebug(LIBKCDDB) << "MusicBrainz is throttling, backing off for" << s->backoff << "ms";
+
+    s->condition.wakeAll();
+  }
+
+    void
+  MusicBrainzScheduler::reportSuccess()
+  {
+    SchedulerState *s = s_scheduler;
+    QMutexLocker locker( &s->mutex );
+
+    s->backoff = 0;
+  }
+
+    MusicBrainzScheduler::Stats
+  MusicBrainzScheduler::stats()
+  {
+    SchedulerState *s = s_scheduler;
+    QMutexLocker locker( &s->mutex );
+
+    Stats stats;
+    stats.queuedInteractive = s->waiting[ Interactive ];
+    stats.queuedBatch = s->waiting[ Batch ];
+    stats.requests = s->requests;
+    stats.throttled = s->throttled;
+    stats.backoff = s->backoff;
+
+    return stats;
+  }
+
+    void
+  MusicBrainzScheduler::setInterval( int interval )
+  {
+    SchedulerState *s = s_scheduler;
+    QMutexLocker locker( &s->mutex );
+
+    s->interval = qMax( 0, interval );
+    s->condition.wakeAll();
+  }
+
+    int
+  MusicBrainzScheduler::interval()
+  {
+    SchedulerState *s = s_scheduler;
+    QMutexLocker locker( &s->mutex );
+
+    return s->interval;
+  }
+}
+
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -0,0 +1,94 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCDDB_MUSICBRAINZSCHEDULER_H
+#define KCDDB_MUSICBRAINZSCHEDULER_H
+
+#include "kcddb_tests_export.h"
+
+#include <QAtomicInt>
+
+namespace KCDDB
+{
+  /**
+   * Paces the requests all lookups in the process send to MusicBrainz.
+   *
+   * MusicBrainz allows one request per second from each client, and answers
+   * anything beyond that with 503. Lookups call acquire() before each
+   * request, which blocks until the request may be sent. Requests are spaced
+   * evenly instead of in bursts, interactive ones go before batch ones, and
+   * requests of the same priority go in the order they were queued.
+   * When the server reports it's overloaded, all requests back off for a
+   * while.
+   */
+  class KCDDB_TESTS_EXPORT MusicBrainzScheduler
+  {
+    public:
+      enum Priority
+      {
+        Interactive,
+        Batch
+      };
+
+      class Stats
+      {
+        public:
+          /**
+           * Requests waiting in acquire()
+           */
+          int queuedInteractive;
+          int queuedBatch;
+          /**
+           * Requests let through so far
+           */
+          quint64 requests;
+          /**
+           * Requests the server answered with 503
+           */
+          quint64 throttled;
+          /**
+           * The extra delay currently added between requests, in ms
+           */
+          int backoff;
+      };
+
+      /**
+       * Blocks until the next request of @p priority may be sent
+       * @param cancelled if it is set while the request waits, the request
+       * leaves the queue without being sent, see wakeUp()
+       * @return false if the request was cancelled
+       */
+      static bool acquire( Priority priority, const QAtomicInt *cancelled = nullptr );
+
+      /**
+       * Lets the requests waiting in acquire() check whether they have been
+       * cancelled
+       */
+      static void wakeUp();
+
+      /**
+       * Tells the scheduler that the server answered the last request with
+       * 503, delaying the next requests
+       */
+      static void reportThrottled();
+      /**
+       * Tells the scheduler that the server answered the last request,
+       * ending any backoff
+       */
+      static void reportSuccess();
+
+      static Stats stats();
+
+      /**
+       * Sets the time between requests in ms, 1000 by default
+       */
+      static void setInterval( int interval );
+      static int interval();
+  };
+}
+
+#endif // KCDDB_MUSICBRAINZSCHEDULER_H
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
@@ -0,0 +1,347 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "packedcache.h"
+#include "logging.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QLockFile>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QSaveFile>
+
+namespace KCDDB
+{
+  namespace
+  {
+    // Don't bother compacting stores smaller than this
+    const qint64 minimumCompactionSize = 1024 * 1024;
+
+    class Record
+    {
+      public:
+        qint64 offset;
+        qint64 size;
+    };
+
+    class PackedLocation
+    {
+      public:
+        PackedLocation()
+          : indexSize(-1), liveBytes(0)
+        {}
+
+        QHash<QString, Record> records;
+        // Bytes of the index file that have been read so far
+        qint64 indexSize;
+        qint64 liveBytes;
+        // The first line of the index file, which changes whenever the
+        // store is compacted
+        QByteArray generation;
+    };
+
+    class PackedStores
+    {
+      public:
+        QMutex mutex;
+        QHash<QString, PackedLocation> locations;
+    };
+
+    Q_GLOBAL_STATIC(PackedStores, s_packedStores)
+
+      QString
+    dataFileName( const QString &cacheDir )
+    {
+      return cacheDir + QLatin1String( "/packed.dat" );
+    }
+
+      QString
+    indexFileName( const QString &cacheDir )
+    {
+      return cacheDir + QLatin1String( "/packed.idx" );
+    }
+
+      QString
+    lockFileName( const QString &cacheDir )
+    {
+      return cacheDir + QLatin1String( "/packed.lock" );
+    }
+
+    // Each entry in the data file starts with a header naming it, so readers
+    // notice when another process has compacted the store under them
+      QByteArray
+    recordHeader( const QString &entry, qint64 size )
+    {
+      return '#' + entry.toUtf8() + ' ' + QByteArray::number( size ) + '\n';
+    }
+
+      QByteArray
+    newGeneration()
+    {
+      return '#' + QByteArray::number( QRandomGenerator::global()->generate64(), 16 ) + '\n';
+    }
+
+      QByteArray
+    indexLine( const QString &entry, qint64 offset, qint64 size )
+    {
+      return entry.toUtf8() + ' ' + QByteArray::number( offset ) + ' ' + QByteArray::number( size ) + '\n';
+    }
+
+    // Reads whatever has been appended to the index file since the last
+    // call, or all of it if the store has been compacted
+      void
+    update( PackedLocation &location, const QString &cacheDir )
+    {
+      QFile f( indexFileName( cacheDir ) );
+
+      // A missing index is an empty store
+      if ( !f.open( QIODevice::ReadOnly ) )
+      {
+        location.records.clear();
+        location.liveBytes = 0;
+        location.indexSize = 0;
+        location.generation.clear();
+        return;
+      }
+
+      // Compaction replaces the index in one go, under a new generation
+      // and with any size
+      QByteArray generation = f.readLine();
+      if ( !generation.startsWith( '#' ) || !generation.endsWith( '\n' ) )
+        generation.clear();
+
+      const qint64 size = f.size();
+
+      if ( generation != location.generation || location.indexSize < 0 || size < location.indexSize )
+      {
+        location.records.clear();
+        location.liveBytes = 0;
+        location.indexSize = generation.size();
+        location.generation = generation;
+      }
+
+      if ( size == location.indexSize || !f.seek( location.indexSize ) )
+        return;
+
+      while ( !f.atEnd() )
+      {
+        const QByteArray line = f.readLine();
+
+        // Another process may be in the middle of appending this line
+        if ( !line.endsWith( '\n' ) )
+          break;
+
+        location.indexSize += line.size();
+
+        if ( line.startsWith( '#' ) )
+          continue;
+
+        const QList<QByteArray> fields = line.trimmed().split( ' ' );
+        if ( fields.count() != 3 )
+          continue;
+
+        const QString entry = QString::fromUtf8( fields[ 0 ] );
+        const qint64 recordSize = fields[ 2 ].toLongLong();
+
+        const auto old = location.records.constFind( entry );
+        if ( old != location.records.constEnd() )
+          location.liveBytes -= old->size;
+
+        // A negative size marks a removed entry
+        if ( recordSize < 0 )
+        {
+          location.records.remove( entry );
+          continue;
+        }
+
+        Record record;
+        record.offset = fields[ 1 ].toLongLong();
+        record.size = recordSize;
+        location.records.insert( entry, record );
+        location.liveBytes += recordSize;
+      }
+    }
+
+      void
+    compact( PackedLocation &location, const QString &cacheDir )
+    {
+      const qint64 dataSize = QFile( dataFileName( cacheDir ) ).size();
+      if ( dataSize < minimumCompactionSize || dataSize < 2 * location.liveBytes )
+        return;
+
+      qCDebug(LIBKCDDB) << "Compacting packed cache in " << cacheDir;
+
+      QFile oldData( dataFileName( cacheDir ) );
+      QSaveFile newData( dataFileName( cacheDir ) );
+      QSaveFile newIndex( indexFileName( cacheDir ) );
+
+      if ( !oldData.open( QIODevice::ReadOnly ) || !newData.open( QIODevice::WriteOnly )
+          || !newIndex.open( QIODevice::WriteOnly ) )
+        return;
+
+      newIndex.write( newGeneration() );
+
+      // Copy in file order, so the old data is read sequentially
+      QMap<qint64, QString> byOffset;
+      for ( auto it = location.records.constBegin(); it != location.records.constEnd(); ++it )
+        byOffset.insert( it->offset, it.key() );
+
+      qint64 offset = 0;
+      for ( auto it = byOffset.constBegin(); it != byOffset.constEnd(); ++it )
+      {
+        const Record record = location.records.value( it.value() );
+        const QByteArray header = recordHeader( it.value(), record.size );
+
+        if ( !oldData.seek( record.offset ) || oldData.readLine() != header )
+          continue;
+
+        const QByteArray data = oldData.read( record.size );
+        if ( data.size() != record.size )
+          continue;
+
+        newData.write( header );
+        newData.write( data );
+        newIndex.write( indexLine( it.value(), offset, record.size ) );
+        offset += header.size() + data.size();
+      }
+
+      // Readers look entries up in the index, so replace the data first
+      if ( newData.commit() )
+        newIndex.commit();
+      else
+        newIndex.cancelWriting();
+
+      location.indexSize = -1;
+      update( location, cacheDir );
+    }
+  }
+
+    bool
+  PackedCache::read( const QString &cacheDir, const QString &entry, QByteArray &data )
+  {
+    const QString dir = QDir::cleanPath( cacheDir );
+
+    QMutexLocker locker( &s_packedStores->mutex );
+
+    PackedLocation &location = s_packedStores->locations[ dir ];
+    update( location, dir );
+
+    for ( int attempt = 0; attempt < 2; ++attempt )
+    {
+      const auto it = location.records.constFind( entry );
+      if ( it == location.records.constEnd() )
+        return false;
+
+      QFile f( dataFileName( dir ) );
+      if ( !f.open( QIODevice::ReadOnly ) )
+        return false;
+
+      if ( f.seek( it->offset ) && f.readLine() == recordHeader( entry, it->size ) )
+      {
+        data = f.read( it->size );
+        if ( data.size() == it->size )
+          return true;
+      }
+
+      // The store was compacted since we read the index
+      location.indexSize = -1;
+      update( location, dir );
+    }
+
+    return false;
+  }
+
+    bool
+  PackedCache::write( const QString &cacheDir, const QString &entry, const QByteArray &data )
+  {
+    const QString dir = QDir::cleanPath( cacheDir );
+
+    QMutexLocker locker( &s_packedStores->mutex );
+
+    // Keeps other processes from appending or compacting at the same time
+    QLockFile lock( lockFileName( dir ) );
+    if ( !lock.lock() )
+    {
+      qCWarning(LIBKCDDB) << "Couldn't lock packed cache in " << dir;
+      return false;
+    }
+
+    PackedLocation &location = s_packedStores->locations[ dir ];
+    update( location, dir );
+
+    QFile dataFile( dataFileName( dir ) );
+    QFile indexFile( indexFileName( dir ) );
+    if ( !dataFile.open( QIODevice::WriteOnly | QIODevice::Append )
+        || !indexFile.open( QIODevice::WriteOnly | QIODevice::Append ) )
+    {
+      qCWarning(LIBKCDDB) << "Couldn't write packed cache in " << dir;
+      return false;
+    }
+
+    const qint64 offset = dataFile.size();
+    if ( dataFile.write( recordHeader( entry, data.size() ) + data ) < 0 )
+      return false;
+    dataFile.close();
+
+    QByteArray line = indexLine( entry, offset, data.size() );
+    if ( indexFile.size() == 0 )
+      line.prepend( newGeneration() );
+
+    indexFile.write( line );
+    indexFile.close();
+
+    update( location, dir );
+    compact( location, dir );
+
+    return true;
+  }
+
+    void
+  PackedCache::remove( const QString &cacheDir, const QString &entry )
+  {
+    const QString dir = QDir::cleanPath( cacheDir );
+
+    QMutexLocker locker( &s_packedStores->mutex );
+
+    PackedLocation &location = s_packedStores->locations[ dir ];
+    update( location, dir );
+
+    if ( !location.records.contains( entry ) )
+      return;
+
+    QLockFile lock( lockFileName( dir ) );
+    if ( !lock.lock() )
+      return;
+
+    QFile indexFile( indexFileName( dir ) );
+    if ( indexFile.open( QIODevice::WriteOnly | QIODevice::Append ) )
+    {
+      indexFile.write( indexLine( entry, 0, -1 ) );
+      indexFile.close();
+    }
+
+    update( location, dir );
+  }
+
+    QStringList
+  PackedCache::entries( const QString &cacheDir )
+  {
+    const QString dir = QDir::cleanPath( cacheDir );
+
+    QMutexLocker locker( &s_packedStores->mutex );
+
+    PackedLocation &location = s_packedStores->locations[ dir ];
+    update( location, dir );
+
+    return location.records.keys();
+  }
+}
+
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
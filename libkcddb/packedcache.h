@@ -0,0 +1,58 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCDDB_PACKEDCACHE_H
+#define KCDDB_PACKEDCACHE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+namespace KCDDB
+{
+  /**
+   * Stores the entries of a cache location in a single file instead of one
+   * file per disc.
+   *
+   * Entries are appended to "packed.dat", and "packed.idx" records the
+   * offset and size of each one, also append-only. Replaced and removed
+   * entries leave garbage behind, which is dropped by rewriting both files
+   * once it makes up more than half of the data. The index starts with a
+   * generation line that changes with each rewrite, so other processes
+   * know to read it again from the start.
+   *
+   * Entries are named like the files of the one-file-per-entry layout,
+   * e.g. "misc/a1107d0a".
+   */
+  class PackedCache
+  {
+    public:
+      /**
+       * Reads @p entry into @p data
+       * @return false if the packed store of @p cacheDir doesn't have it
+       */
+      static bool read( const QString &cacheDir, const QString &entry, QByteArray &data );
+
+      /**
+       * Adds @p entry to the packed store of @p cacheDir, replacing any
+       * older version of it
+       */
+      static bool write( const QString &cacheDir, const QString &entry, const QByteArray &data );
+
+      /**
+       * Forgets @p entry, if it is in the packed store of @p cacheDir
+       */
+      static void remove( const QString &cacheDir, const QString &entry );
+
+      /**
+       * @return all entries in the packed store of @p cacheDir
+       */
+      static QStringList entries( const QString &cacheDir );
+  };
+}
+
+#endif // KCDDB_PACKEDCACHE_H
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
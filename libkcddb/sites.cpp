@@ -5,8 +5,7 @@
 */
 
 #include "sites.h"
-
-#include <KIO/TransferJob>
+#include "synchttpclient.h"
 #include <QDebug>
 #include <QRegularExpression>
 #include <QTextStream>
@@ -40,10 +39,8 @@ namespace KCDDB
 
     QList<Mirror> result;
 
-    KIO::TransferJob* job = KIO::get( url, KIO::NoReload, KIO::HideProgressInfo );
     QByteArray data;
-    QObject::connect( job, &KIO::TransferJob::data, [&data](KIO::Job *, const QByteArray &d){ data += d; } );
-    if( job->exec() )
+    if( SyncHTTPClient::get( url, data ) )
     {
       result = readData( data );
     }
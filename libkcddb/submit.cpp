@@ -33,7 +33,7 @@ namespace KCDDB
     if (!validCategory(cdInfo.get(Category).toString()))
       return InvalidCategory;
 
-    KIO::Job* job = createJob(cdInfo);
+    HTTPJob* job = createJob(cdInfo);
 
     if (!job)
       return UnknownError;
@@ -56,17 +56,17 @@ namespace KCDDB
   {
     unsigned numTracks = cdInfo.numberOfTracks();
 
-    diskData_ += QLatin1String( "# xmcd\n" );
-    diskData_ += QLatin1String( "#\n" );
-    diskData_ += QLatin1String( "# Track frame offsets:\n" );
+    diskData_ += "# xmcd\n";
+    diskData_ += "#\n";
+    diskData_ += "# Track frame offsets:\n";
 
     for (uint i=0; i < numTracks; i++)
-        diskData_ += QString::fromLatin1("#\t%1\n").arg(offsetList[i]);
+        diskData_ += "#\t" + QByteArray::number(offsetList[i]) + '\n';
 
     int l = offsetList[numTracks]/75;
-    diskData_ += QString::fromLatin1("# Disc length: %1 seconds\n").arg(l);
+    diskData_ += "# Disc length: " + QByteArray::number(l) + " seconds\n";
 
-    diskData_ += cdInfo.toString(true);
+    diskData_ += cdInfo.toUtf8(true);
 
 	qCDebug(LIBKCDDB) << "diskData_ == " << diskData_;
   }
@@ -14,13 +14,10 @@
 #include "cdinfo.h"
 #include <QObject>
 
-namespace KIO
-{
-  class Job;
-}
-
 namespace KCDDB
 {
+  class HTTPJob;
+
   class Submit : public CDDB, public QObject
   {
     public:
@@ -31,14 +28,14 @@ namespace KCDDB
       Result submit( CDInfo cdInfo, const TrackOffsetList &offsetList);
 
     protected:
-      virtual KIO::Job* createJob(const CDInfo& cdInfo) = 0;
-      virtual Result runJob(KIO::Job* job) = 0;
+      virtual HTTPJob* createJob(const CDInfo& cdInfo) = 0;
+      virtual Result runJob(HTTPJob* job) = 0;
     
       bool validCategory(const QString&);
 
       Result parseWrite( const QString & );
       virtual void makeDiskData( const CDInfo&, const TrackOffsetList& );
-      QString diskData_;
+      QByteArray diskData_;
   };
 }
 
@@ -7,6 +7,7 @@
 */
 
 #include "synccddbplookup.h"
+#include "cddbpsessionpool.h"
 #include "logging.h"
 
 #include <QStringList>
@@ -28,60 +29,92 @@ namespace KCDDB
   (
     const QString         & hostName,
     uint                    port,
-    const TrackOffsetList & trackOffsetList
+    const DiscSignature   & signature
   )
   {
-    trackOffsetList_ = trackOffsetList;
+    signature_ = signature;
+    hostName_ = hostName;
+    port_ = port;
 
-    socket_ = new QTcpSocket;
-    socket_->connectToHost(hostName, port);
+    Result result;
 
-    if ( !socket_->waitForConnected(30000) )
+    // A session left over from an earlier lookup is already past the handshake
+    socket_ = CDDBPSessionPool::take( hostName, port );
+    const bool reused = socket_ != nullptr;
+
+    if ( !reused )
     {
-      qCDebug(LIBKCDDB) << "Couldn't connect to " << socket_->peerName() << ":" << socket_->peerPort();
-      qCDebug(LIBKCDDB) << "Socket error: " << socket_->errorString();
-      const auto socketError = socket_->error();
-      if ( socketError == QAbstractSocket::HostNotFoundError )
-        return HostNotFound;
-      else if ( socketError == QAbstractSocket::SocketTimeoutError )
-        return NoResponse;
-      else
-        return UnknownError;
+      result = connectToServer();
+      if ( Success != result )
+        return result;
     }
 
-    Result result;
-
-    // Try a handshake.
-    result = shakeHands();
-    if ( Success != result )
-      return result;
-
     // Run a query.
     result = runQuery();
+
+    if ( ServerError == result && reused )
+    {
+      // The server may have dropped the session since it was pooled
+      qCDebug(LIBKCDDB) << "Pooled session failed, reconnecting";
+
+      delete socket_;
+      socket_ = nullptr;
+      matchList_.clear();
+
+      result = connectToServer();
+      if ( Success != result )
+        return result;
+
+      result = runQuery();
+    }
+
     if ( Success != result )
       return result;
 
     if (matchList_.isEmpty())
+    {
+      releaseSession();
       return NoRecordFound;
+    }
 
 	qCDebug(LIBKCDDB) << matchList_.count() << " matches found.";
 
+    // Ask for all matches at once. The server answers in order, so reading
+    // them costs a single round trip however many there are.
+    for ( const CDDBMatch &match : qAsConst( matchList_ ) )
+      sendRead( match );
+
     // For each match, read the cd info from the server and save it to
     // cdInfoList.
-    CDDBMatchList::ConstIterator matchIt = matchList_.constBegin();
+    for ( const CDDBMatch &match : qAsConst( matchList_ ) )
+      matchToCDInfo( match );
 
-    while ( matchIt != matchList_.constEnd() )
-    {
-      CDDBMatch match( *matchIt );
-      result = matchToCDInfo( match );
-      ++matchIt;
-    }
+    releaseSession();
 
-    sendQuit();
+    return Success;
+  }
 
-    close();
+    Result
+  SyncCDDBPLookup::connectToServer()
+  {
+    socket_ = new QTcpSocket;
+    socket_->connectToHost(hostName_, port_);
 
-    return Success;
+    if ( !socket_->waitForConnected(30000) )
+    {
+      qCDebug(LIBKCDDB) << "Couldn't connect to " << socket_->peerName() << ":" << socket_->peerPort();
+      qCDebug(LIBKCDDB) << "Socket error: " << socket_->errorString();
+      const auto socketError = socket_->error();
+      if ( socketError == QAbstractSocket::HostNotFoundError )
+        return HostNotFound;
+      else if ( socketError == QAbstractSocket::SocketTimeoutError )
+        return NoResponse;
+      else
+        return UnknownError;
+    }
+
+    // Try a handshake.
+    return shakeHands();
   }
 
     Result
@@ -138,7 +171,9 @@ namespace KCDDB
     Result
   SyncCDDBPLookup::matchToCDInfo( const CDDBMatch & match )
   {
-    sendRead( match );
+    // The read has already been sent
+    category_ = match.first;
+    discid_ = match.second;
 
     QString line = readLine();
 
@@ -146,18 +181,18 @@ namespace KCDDB
     if ( Success != result )
       return result;
 
-    QStringList lineList;
-    line = readLine();
+    QByteArray data;
+    QByteArray dataLine = readRawLine();
 
-    while ( !line.startsWith(QLatin1String( "." )) && !line.isNull() )
+    while ( !dataLine.startsWith('.') && !dataLine.isNull() )
     {
-      lineList.append( line );
-      line = readLine();
+      data += dataLine;
+      dataLine = readRawLine();
     }
 
     CDInfo info;
 
-    if ( info.load( lineList ) )
+    if ( info.loadUtf8( data ) )
     {
       info.set( QLatin1String( "category" ), category_ );
       info.set( QLatin1String( "discid" ), discid_ );
@@ -170,20 +205,26 @@ namespace KCDDB
 
     QString
   SyncCDDBPLookup::readLine()
+  {
+    return QString::fromUtf8(readRawLine());
+  }
+
+    QByteArray
+  SyncCDDBPLookup::readRawLine()
   {
     if ( !isConnected() )
     {
 	  qCDebug(LIBKCDDB) << "socket status: " << socket_->state();
-      return QString();
+      return QByteArray();
     }
 
     if (!socket_->canReadLine())
     {
       if (!socket_->waitForReadyRead(-1))
-        return QString();
+        return QByteArray();
     }
 
-    return QString::fromUtf8(socket_->readLine());
+    return socket_->readLine();
   }
 }
 
@@ -20,16 +20,18 @@ namespace KCDDB
       SyncCDDBPLookup();
       virtual ~SyncCDDBPLookup();
 
-      Result lookup( const QString &, uint, const TrackOffsetList & ) override;
+      Result lookup( const QString &, uint, const DiscSignature & ) override;
 
       CDInfoList lookupResponse() const;
 
     protected:
+      Result connectToServer();
       Result shakeHands();
       Result runQuery();
       Result matchToCDInfo( const CDDBMatch & );
 
       QString readLine();
+      QByteArray readRawLine();
   };
 }
 
@@ -0,0 +1,455 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "synchttpclient.h"
+#include "cddb.h"
+#include "logging.h"
+
+#include <QHash>
+#include <QHostAddress>
+#include <QNetworkProxyFactory>
+#include <QTcpSocket>
+#if QT_CONFIG(ssl)
+#include <QSslSocket>
+#endif
+#include <QThreadStorage>
+#include <QUrl>
+
+namespace KCDDB
+{
+  namespace
+  {
+    const int timeout = 30000;
+    const int maxRedirects = 5;
+    // Far more than any lookup response, a server sending more is broken
+    // or means harm
+    const qint64 maxBodySize = 16 * 1024 * 1024;
+
+    // Idle keep-alive connections of one thread, by host and port
+    class Connections
+    {
+      public:
+        ~Connections()
+        {
+          qDeleteAll( sockets );
+        }
+
+        QHash<QString, QTcpSocket *> sockets;
+    };
+
+    Q_GLOBAL_STATIC(QThreadStorage<Connections *>, s_connections)
+
+      bool
+    isSupported( const QUrl &url )
+    {
+      if ( url.scheme() == QLatin1String( "http" ) )
+        return true;
+
+#if QT_CONFIG(ssl)
+      if ( url.scheme() == QLatin1String( "https" ) )
+        return QSslSocket::supportsSsl();
+#endif
+
+      return false;
+    }
+
+      int
+    defaultPort( const QUrl &url )
+    {
+      return url.scheme() == QLatin1String( "https" ) ? 443 : 80;
+    }
+
+    // The proxy the system settings ask for, e.g. through $http_proxy
+      QNetworkProxy
+    proxyFor( const QUrl &url )
+    {
+      const QHostAddress address( url.host() );
+      if ( url.host() == QLatin1String( "localhost" ) || address.isLoopback() )
+        return QNetworkProxy::NoProxy;
+
+      const QList<QNetworkProxy> proxies =
+        QNetworkProxyFactory::systemProxyForQuery( QNetworkProxyQuery( url ) );
+
+      for ( const QNetworkProxy &proxy : proxies )
+      {
+        if ( QNetworkProxy::HttpProxy == proxy.type() || QNetworkProxy::Socks5Proxy == proxy.type() )
+          return proxy;
+        if ( QNetworkProxy::HttpCachingProxy == proxy.type() )
+          return QNetworkProxy( QNetworkProxy::HttpProxy, proxy.hostName(), proxy.port(), proxy.user(), proxy.password() );
+        if ( QNetworkProxy::NoProxy == proxy.type() )
+          break;
+      }
+
+      return QNetworkProxy::NoProxy;
+    }
+
+    // Plain http requests go to an HTTP proxy as they are, everything else
+    // is tunneled through the proxy by the socket
+      bool
+    forwardsTo( const QUrl &url, const QNetworkProxy &proxy )
+    {
+      return QNetworkProxy::HttpProxy == proxy.type() && url.scheme() == QLatin1String( "http" );
+    }
+
+      Connections &
+    connections()
+    {
+      if ( !s_connections->hasLocalData() )
+        s_connections->setLocalData( new Connections );
+
+      return *s_connections->localData();
+    }
+
+    class Response
+    {
+      public:
+        Response()
+          : status( 0 ), keepAlive( false )
+        {}
+
+        int status;
+        bool keepAlive;
+        QByteArray location;
+        QByteArray body;
+    };
+
+      bool
+    readLine( QTcpSocket *socket, QByteArray &line )
+    {
+      while ( !socket->canReadLine() )
+      {
+        if ( !socket->waitForReadyRead( timeout ) )
+          return false;
+      }
+
+      line = socket->readLine();
+      return true;
+    }
+
+      bool
+    readBytes( QTcpSocket *socket, qint64 size, QByteArray &data )
+    {
+      if ( size > maxBodySize - data.size() )
+      {
+        qCDebug(LIBKCDDB) << "Response body too large";
+        return false;
+      }
+
+      while ( size > 0 )
+      {
+        if ( 0 == socket->bytesAvailable() && !socket->waitForReadyRead( timeout ) )
+          return false;
+
+        const QByteArray chunk = socket->read( size );
+        data += chunk;
+        size -= chunk.size();
+      }
+
+      return true;
+    }
+
+      bool
+    readToEnd( QTcpSocket *socket, QByteArray &data )
+    {
+      for ( ;; )
+      {
+        data += socket->readAll();
+
+        if ( data.size() > maxBodySize )
+        {
+          qCDebug(LIBKCDDB) << "Response body too large";
+          return false;
+        }
+
+        if ( !socket->waitForReadyRead( timeout ) )
+        {
+          data += socket->readAll();
+          // The body ends when the server closes the connection
+          return data.size() <= maxBodySize
+            && ( QAbstractSocket::RemoteHostClosedError == socket->error()
+              || QAbstractSocket::ConnectedState != socket->state() );
+        }
+      }
+    }
+
+      bool
+    readChunked( QTcpSocket *socket, QByteArray &data )
+    {
+      QByteArray line;
+
+      for ( ;; )
+      {
+        if ( !readLine( socket, line ) )
+          return false;
+
+        // Chunk extensions follow the size after a ';'
+        const int semicolon = line.indexOf( ';' );
+        bool ok;
+        const qint64 size = ( semicolon < 0 ? line : line.left( semicolon ) ).trimmed().toLongLong( &ok, 16 );
+        if ( !ok || size < 0 )
+          return false;
+
+        if ( 0 == size )
+          break;
+
+        if ( !readBytes( socket, size, data ) || !readLine( socket, line ) )
+          return false;
+      }
+
+      // Skip the trailer
+      do
+      {
+        if ( !readLine( socket, line ) )
+          return false;
+      } while ( !line.trimmed().isEmpty() );
+
+      return true;
+    }
+
+      bool
+    request( QTcpSocket *socket, const QUrl &url, const QNetworkProxy &proxy, Response &response )
+    {
+      QByteArray host = url.host( QUrl::FullyEncoded ).toLatin1();
+      if ( url.port( defaultPort( url ) ) != defaultPort( url ) )
+        host += ':' + QByteArray::number( url.port() );
+
+      QByteArray path = url.path( QUrl::FullyEncoded ).toLatin1();
+      if ( path.isEmpty() )
+        path = "/";
+      if ( url.hasQuery() )
+        path += '?' + url.query( QUrl::FullyEncoded ).toLatin1();
+
+      QByteArray proxyHeaders;
+      if ( forwardsTo( url, proxy ) )
+      {
+        // Proxies want the absolute URL
+        path = url.scheme().toLatin1() + "://" + host + path;
+
+        if ( !proxy.user().isEmpty() )
+          proxyHeaders = "Proxy-Authorization: Basic "
+            + ( proxy.user() + QLatin1Char( ':' ) + proxy.password() ).toUtf8().toBase64() + "\r\n";
+      }
+
+      const QByteArray request = "GET " + path + " HTTP/1.1\r\n"
+        "Host: " + host + "\r\n"
+        "User-Agent: " + CDDB::clientName().toLatin1() + '/' + CDDB::clientVersion().toLatin1() + "\r\n"
+        "Connection: keep-alive\r\n"
+        + proxyHeaders +
+        "\r\n";
+
+      socket->write( request );
+      if ( !socket->waitForBytesWritten( timeout ) )
+        return false;
+
+      QByteArray line;
+      if ( !readLine( socket, line ) )
+        return false;
+
+      // HTTP/1.1 200 OK
+      const QList<QByteArray> statusLine = line.trimmed().split( ' ' );
+      if ( statusLine.count() < 2 || !statusLine[ 0 ].startsWith( "HTTP/" ) )
+        return false;
+
+      response.status = statusLine[ 1 ].toInt();
+      response.keepAlive = statusLine[ 0 ] != "HTTP/1.0";
+
+      qint64 contentLength = -1;
+      bool chunked = false;
+
+      for ( ;; )
+      {
+        if ( !readLine( socket, line ) )
+          return false;
+
+        line = line.trimmed();
+        if ( line.isEmpty() )
+          break;
+
+        const int colon = line.indexOf( ':' );
+        if ( colon <= 0 )
+          continue;
+
+        const QByteArray name = line.left( colon ).trimmed().toLower();
+        const QByteArray value = line.mid( colon + 1 ).trimmed();
+
+        if ( name == "content-length" )
+          contentLength = value.toLongLong();
+        else if ( name == "transfer-encoding" )
+          chunked = value.toLower().contains( "chunked" );
+        else if ( name == "connection" )
+          response.keepAlive = value.toLower() == "keep-alive" || ( response.keepAlive && value.toLower() != "close" );
+        else if ( name == "location" )
+          response.location = value;
+      }
+
+      // These never have a body
+      if ( ( response.status >= 100 && response.status < 200 ) || 204 == response.status || 304 == response.status )
+        return true;
+
+      if ( chunked )
+        return readChunked( socket, response.body );
+
+      if ( contentLength >= 0 )
+        return readBytes( socket, contentLength, response.body );
+
+      response.keepAlive = false;
+      return readToEnd( socket, response.body );
+    }
+
+      QTcpSocket *
+    connectTo( const QUrl &url, const QNetworkProxy &proxy )
+    {
+      QTcpSocket *socket;
+      bool connected;
+
+#if QT_CONFIG(ssl)
+      if ( url.scheme() == QLatin1String( "https" ) )
+      {
+        QSslSocket *sslSocket = new QSslSocket;
+        sslSocket->setProxy( proxy );
+        sslSocket->connectToHostEncrypted( url.host(), url.port( defaultPort( url ) ) );
+        connected = sslSocket->waitForEncrypted( timeout );
+        socket = sslSocket;
+      }
+      else
+#endif
+      if ( forwardsTo( url, proxy ) )
+      {
+        socket = new QTcpSocket;
+        socket->setProxy( QNetworkProxy::NoProxy );
+        socket->connectToHost( proxy.hostName(), proxy.port() );
+        connected = socket->waitForConnected( timeout );
+      }
+      else
+      {
+        socket = new QTcpSocket;
+        socket->setProxy( proxy );
+        socket->connectToHost( url.host(), url.port( defaultPort( url ) ) );
+        connected = socket->waitForConnected( timeout );
+      }
+
+      if ( !connected )
+      {
+        qCDebug(LIBKCDDB) << "Couldn't connect to " << url.host() << ": " << socket->errorString();
+        delete socket;
+        return nullptr;
+      }
+
+      return socket;
+    }
+
+      QTcpSocket *
+    takeConnection( const QString &key )
+    {
+      QTcpSocket *socket = connections().sockets.take( key );
+      if ( !socket )
+        return nullptr;
+
+      // Let the socket notice if the server has closed the connection
+      socket->waitForReadyRead( 0 );
+
+      if ( QAbstractSocket::ConnectedState != socket->state() || socket->bytesAvailable() > 0 )
+      {
+        delete socket;
+        return nullptr;
+      }
+
+      return socket;
+    }
+  }
+
+    bool
+  SyncHTTPClient::get( const QUrl &url, QByteArray &data, int *status )
+  {
+    QUrl current = url;
+
+    if ( status )
+      *status = 0;
+
+    for ( int redirect = 0; redirect <= maxRedirects; ++redirect )
+    {
+      if ( !isSupported( current ) )
+      {
+        qCDebug(LIBKCDDB) << "Can't fetch " << current.toDisplayString() << ", unsupported scheme";
+        return false;
+      }
+
+      const QNetworkProxy proxy = proxyFor( current );
+
+      QString key = current.scheme() + QLatin1Char( ':' ) + current.host()
+        + QLatin1Char( ':' ) + QString::number( current.port( defaultPort( current ) ) );
+      if ( QNetworkProxy::NoProxy != proxy.type() )
+        key += QLatin1String( " via " ) + proxy.hostName() + QLatin1Char( ':' ) + QString::number( proxy.port() );
+
+      QTcpSocket *socket = takeConnection( key );
+      const bool reused = socket != nullptr;
+
+      if ( !socket )
+        socket = connectTo( current, proxy );
+      if ( !socket )
+        return false;
+
+      Response response;
+      bool ok = request( socket, current, proxy, response );
+
+      if ( !ok && reused )
+      {
+        // The server may have closed the kept alive connection in the meantime
+        delete socket;
+        socket = connectTo( current, proxy );
+        if ( !socket )
+          return false;
+
+        response = Response();
+        ok = request( socket, current, proxy, response );
+      }
+
+      if ( ok && response.keepAlive && QAbstractSocket::ConnectedState == socket->state() )
+      {
+        delete connections().sockets.value( key );
+        connections().sockets.insert( key, socket );
+      }
+      else
+        delete socket;
+
+      if ( !ok )
+      {
+        qCDebug(LIBKCDDB) << "Request for " << current.toDisplayString() << " failed";
+        return false;
+      }
+
+      if ( response.status >= 300 && response.status < 400 && !response.location.isEmpty() )
+      {
+        const QUrl next = current.resolved( QUrl::fromEncoded( response.location ) );
+
+        // Never from https to anything less safe
+        if ( next.scheme() != current.scheme()
+            && !( current.scheme() == QLatin1String( "http" ) && next.scheme() == QLatin1String( "https" ) ) )
+        {
+          qCDebug(LIBKCDDB) << "Not following redirect from " << current.toDisplayString()
+            << " to " << next.toDisplayString();
+          if ( status )
+            *status = response.status;
+          return false;
+        }
+
+        current = next;
+        continue;
+      }
+
+      if ( status )
+        *status = response.status;
+
+      data = response.body;
+      return response.status >= 200 && response.status < 300;
+    }
+
+    qCDebug(LIBKCDDB) << "Too many redirects for " << url.toDisplayString();
+    return false;
+  }
+}
+
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
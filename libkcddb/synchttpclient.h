@@ -0,0 +1,48 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KCDDB_SYNCHTTPCLIENT_H
+#define KCDDB_SYNCHTTPCLIENT_H
+
+#include "kcddb_tests_export.h"
+
+#include <QByteArray>
+
+class QUrl;
+
+namespace KCDDB
+{
+  /**
+   * Fetches http URLs by blocking on the socket, without running an event
+   * loop.
+   *
+   * It can be used from any thread, including threads that weren't started
+   * by Qt and have no event loop, and doesn't deliver unrelated events to
+   * the caller the way a nested event loop would. Connections are kept
+   * alive and reused by later requests from the same thread. https URLs
+   * work if Qt was built with SSL support.
+   *
+   * Requests go through the proxy of the system settings as
+   * QNetworkProxyFactory::systemProxyForQuery() reports it, on Unix from
+   * $http_proxy and friends. Proxies that are only configured for KIO
+   * aren't used.
+   */
+  class KCDDB_TESTS_EXPORT SyncHTTPClient
+  {
+    public:
+      /**
+       * Fetches @p url into @p data, following redirects that keep the
+       * scheme or go from http to https. The HTTP status of the response is
+       * stored in @p status if given, 0 if there was none. Responses larger
+       * than 16 MiB are refused.
+       * @return true if the server answered with a 2xx status
+       */
+      static bool get( const QUrl &url, QByteArray &data, int *status = nullptr );
+  };
+}
+
+#endif // KCDDB_SYNCHTTPCLIENT_H
+// vim:tabstop=2:shiftwidth=2:expandtab:cinoptions=(s,U1,m1
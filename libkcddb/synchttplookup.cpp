@@ -6,10 +6,9 @@
 */
 
 #include "synchttplookup.h"
+#include "synchttpclient.h"
 #include "logging.h"
 
-#include <KIO/TransferJob>
-
 namespace KCDDB
 {
   SyncHTTPLookup::SyncHTTPLookup()
@@ -27,10 +26,10 @@ namespace KCDDB
   (
     const QString         & hostName,
     uint                    port,
-    const TrackOffsetList & trackOffsetList
+    const DiscSignature   & signature
   )
   {
-    trackOffsetList_ = trackOffsetList;
+    signature_ = signature;
 
     initURL( hostName, port );
 
@@ -94,14 +93,9 @@ namespace KCDDB
   {
 	qCDebug(LIBKCDDB) << "About to fetch: " << cgiURL_.url();
 
-    KIO::TransferJob* job = KIO::get( cgiURL_, KIO::NoReload, KIO::HideProgressInfo );
-
-    if ( nullptr == job )
-      return ServerError;
-
-    QObject::connect( job, &KIO::TransferJob::data, [&](KIO::Job *, const QByteArray &data){ data_ += data; } );
-
-    if (!job->exec())
+    // Blocks on the socket instead of running an event loop, so lookups
+    // can be made from threads without one
+    if ( !SyncHTTPClient::get( cgiURL_, data_ ) )
       return ServerError;
 
     jobFinished();
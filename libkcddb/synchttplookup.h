@@ -19,7 +19,7 @@ namespace KCDDB
       SyncHTTPLookup();
       virtual ~SyncHTTPLookup();
 
-      Result lookup( const QString &, uint, const TrackOffsetList & ) override;
+      Result lookup( const QString &, uint, const DiscSignature & ) override;
 
       CDInfoList lookupResponse() const;
 
@@ -6,8 +6,6 @@
 
 #include "synchttpsubmit.h"
 
-#include <KIO/Job>
-
 namespace KCDDB
 {
   SyncHTTPSubmit::SyncHTTPSubmit(const QString& from, const QString& hostname, uint port)
@@ -21,7 +19,7 @@ namespace KCDDB
 
   }
 
-  Result SyncHTTPSubmit::runJob(KIO::Job* job)
+  Result SyncHTTPSubmit::runJob(HTTPJob* job)
   {
     if (job->exec())
       return Success;
@@ -18,7 +18,7 @@ namespace KCDDB
       virtual ~SyncHTTPSubmit();
 
     protected:
-      Result runJob(KIO::Job* job) override;
+      Result runJob(HTTPJob* job) override;
   } ;
 }
 
@@ -8,6 +8,8 @@
 #include "asynchttplookuptest.h"
 #include "libkcddb/cache.h"
 #include "libkcddb/lookup.h"
+#include <QTcpServer>
+#include <QTcpSocket>
 #include <QTest>
 
 void AsyncHTTPLookupTest::testLookup()
@@ -79,6 +81,35 @@ void AsyncHTTPLookupTest::testLookup()
   QCOMPARE(m_info.track(9).get(Artist).toString(),QString::fromUtf8("Kruder & Dorfmeister"));
 }
 
+void AsyncHTTPLookupTest::testDestroyWhileRunning()
+{
+  // A server that never answers
+  QTcpServer server;
+  QVERIFY(server.listen(QHostAddress::LocalHost));
+
+  Client *client = new Client;
+  client->config().setHostname(QString::fromUtf8("127.0.0.1"));
+  client->config().setPort(server.serverPort());
+  client->config().setCacheLookupEnabled(false);
+  client->config().setNegativeCacheTTL(0);
+  client->config().setFreedbLookupEnabled(true);
+  client->config().setMusicBrainzLookupEnabled(false);
+  client->config().setFreedbLookupTransport(Lookup::HTTP);
+  client->config().setHttpBackend(Config::EnumHttpBackend::QtNetwork);
+  client->setBlockingMode( false );
+
+  client->lookup(TrackOffsetList() << 150 << 29462 << 316732);
+
+  QTRY_VERIFY(server.hasPendingConnections());
+  QTcpSocket *socket = server.nextPendingConnection();
+  QTRY_VERIFY(socket->bytesAvailable() > 0);
+
+  delete client;
+
+  // The request has been stopped, not left to run on its own
+  QTRY_COMPARE(socket->state(), QAbstractSocket::UnconnectedState);
+}
+
   void
 AsyncHTTPLookupTest::slotFinished(Result r)
 {
@@ -19,6 +19,7 @@ class AsyncHTTPLookupTest : public QObject
   Q_OBJECT
   private Q_SLOTS:
     void testLookup();
+    void testDestroyWhileRunning();
     void slotFinished(KCDDB::Result);
 
   private:
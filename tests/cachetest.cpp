@@ -8,7 +8,12 @@
 #include "libkcddb/cache.h"
 
 #include "libkcddb/client.h"
+#include "libkcddb/config.h"
+#include "libkcddb/discid.h"
 #include "config-musicbrainz.h"
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
 #include <QTest>
 
 using namespace KCDDB;
@@ -44,6 +49,9 @@ void CacheTest::initTestCase()
 
 void CacheTest::cleanupTestCase()
 {
+  QDir(QDir::homePath()+QString::fromUtf8("/.cddbTest/index.d")).removeRecursively();
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/packed.dat"));
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/packed.idx"));
   QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/"));
 }
 
@@ -102,7 +110,7 @@ void CacheTest::testUser()
 
 void CacheTest::testMusicbrainz()
 {
-#ifdef HAVE_MUSICBRAINZ5
+#ifdef HAVE_MUSICBRAINZ
   CDInfo testInfo = m_info;
   testInfo.set(QString::fromUtf8("source"), QString::fromUtf8("musicbrainz"));
   testInfo.set(QString::fromUtf8("discid"), QString::fromUtf8("wdABQ7s86gS7eVmS74CCQ6KwPUI-"));
@@ -114,6 +122,316 @@ void CacheTest::testMusicbrainz()
 #endif
 }
 
+void CacheTest::testIndexRebuild()
+{
+  // Entries copied into the cache by hand are found although the index
+  // doesn't list them, and once the index has been rebuilt
+  CDInfo testInfo = m_info;
+  testInfo.set(QString::fromUtf8("discid"), QString::fromUtf8("a1107d0a"));
+
+  QVERIFY(QDir(QDir::homePath()+QString::fromUtf8("/.cddbTest/index.d")).exists());
+
+  QDir().mkpath(QDir::homePath()+QString::fromUtf8("/.cddbTest/rock/"));
+  QFile f(QDir::homePath()+QString::fromUtf8("/.cddbTest/rock/a1107d0a"));
+  QVERIFY(f.open(QIODevice::WriteOnly));
+  f.write(testInfo.toString().toUtf8());
+  f.close();
+
+  m_client->config().setMemoryCacheSize(0);
+
+  for (int rebuilt = 0; rebuilt < 2; ++rebuilt) {
+    if (rebuilt) {
+      QDir(QDir::homePath()+QString::fromUtf8("/.cddbTest/index.d")).removeRecursively();
+      Cache::rebuildIndex(m_client->config());
+    }
+
+    bool found = false;
+    const CDInfoList results = Cache::lookup(m_list, m_client->config());
+    for (const CDInfo &newInfo : results) {
+      if (newInfo.get(Category).toString() == QString::fromUtf8("rock") && newInfo.get(Title) == m_info.get(Title))
+        found = true;
+    }
+    QVERIFY(found);
+  }
+
+  m_client->config().setMemoryCacheSize(64);
+
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/rock/a1107d0a"));
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/rock/"));
+}
+
+void CacheTest::testIndexReplaced()
+{
+  CDInfo testInfo = m_info;
+  testInfo.set(QString::fromUtf8("source"), QString::fromUtf8("user"));
+
+  QVERIFY(verify(QString::fromUtf8("user"), QString::fromUtf8("a1107d0a"), testInfo));
+
+  // Another process rebuilds the index, and the bucket of the disc grows
+  // instead of shrinking
+  testInfo.set(QString::fromUtf8("discid"), QString::fromUtf8("a1107d0a"));
+  QDir().mkpath(QDir::homePath()+QString::fromUtf8("/.cddbTest/rock/"));
+  QFile f(QDir::homePath()+QString::fromUtf8("/.cddbTest/rock/a1107d0a"));
+  QVERIFY(f.open(QIODevice::WriteOnly));
+  f.write(testInfo.toString().toUtf8());
+  f.close();
+
+  QString bucket;
+  QDirIterator it(QDir::homePath()+QString::fromUtf8("/.cddbTest/index.d"), QDir::Files);
+  while (it.hasNext()) {
+    QFile b(it.next());
+    if (b.open(QIODevice::ReadOnly) && b.readAll().contains("a1107d0a user/a1107d0a"))
+      bucket = b.fileName();
+  }
+  QVERIFY(!bucket.isEmpty());
+
+  QSaveFile replaced(bucket);
+  QVERIFY(replaced.open(QIODevice::WriteOnly));
+  replaced.write("#another-generation\n");
+  replaced.write("a1107d0a user/a1107d0a\n");
+  replaced.write("a1107d0a rock/a1107d0a\n");
+  QVERIFY(replaced.commit());
+
+  m_client->config().setMemoryCacheSize(0);
+
+  bool user = false;
+  bool rock = false;
+  const CDInfoList results = Cache::lookup(m_list, m_client->config());
+  for (const CDInfo &newInfo : results) {
+    if (newInfo.get(QString::fromUtf8("source")).toString() == QString::fromUtf8("user"))
+      user = true;
+    if (newInfo.get(Category).toString() == QString::fromUtf8("rock"))
+      rock = true;
+  }
+  QVERIFY(user);
+  QVERIFY(rock);
+
+  m_client->config().setMemoryCacheSize(64);
+
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/rock/a1107d0a"));
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/rock/"));
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/user/a1107d0a"));
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/user/"));
+}
+
+void CacheTest::testMemoryCache()
+{
+  CDInfo testInfo = m_info;
+  testInfo.set(QString::fromUtf8("source"), QString::fromUtf8("user"));
+
+  QVERIFY(verify(QString::fromUtf8("user"), QString::fromUtf8("a1107d0a"), testInfo));
+
+  // Repeated lookups are answered from memory, without reading the file again
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/user/a1107d0a"));
+  QCOMPARE(Cache::lookup(m_list, m_client->config()).count(), 1);
+
+  m_client->config().setMemoryCacheSize(0);
+  QVERIFY(Cache::lookup(m_list, m_client->config()).isEmpty());
+  m_client->config().setMemoryCacheSize(64);
+
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/user/"));
+}
+
+void CacheTest::testNegative()
+{
+  // Off by default
+  Cache::storeNegative(m_list, m_client->config());
+  QVERIFY(!Cache::lookupNegative(m_list, m_client->config()));
+
+  m_client->config().setNegativeCacheTTL(86400);
+  QVERIFY(!Cache::lookupNegative(m_list, m_client->config()));
+
+  Cache::storeNegative(m_list, m_client->config());
+  QVERIFY(Cache::lookupNegative(m_list, m_client->config()));
+
+  // Another disc with the same freedb id is still unknown
+  TrackOffsetList otherList = m_list;
+  otherList[1] += 1;
+  QVERIFY(!Cache::lookupNegative(otherList, m_client->config()));
+
+  m_client->config().setNegativeCacheTTL(0);
+  QVERIFY(!Cache::lookupNegative(m_list, m_client->config()));
+  m_client->config().setNegativeCacheTTL(86400);
+
+  // Storing an entry for the disc forgets that it was missing
+  CDInfo testInfo = m_info;
+  testInfo.set(QString::fromUtf8("source"), QString::fromUtf8("user"));
+  Cache::store(m_list, testInfo, m_client->config());
+  QVERIFY(!Cache::lookupNegative(m_list, m_client->config()));
+
+  m_client->config().setNegativeCacheTTL(0);
+
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/user/a1107d0a"));
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/user/"));
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/negative/"));
+}
+
+void CacheTest::testPacked()
+{
+  m_client->config().setCacheBackend(Config::EnumCacheBackend::Packed);
+
+  CDInfo testInfo = m_info;
+  testInfo.set(QString::fromUtf8("source"), QString::fromUtf8("freedb"));
+  testInfo.set(QString::fromUtf8("discid"), QString::fromUtf8("a1107d0a"));
+  testInfo.set(QString::fromUtf8("category"), QString::fromUtf8("jazz"));
+
+  QVERIFY(verify(QString::fromUtf8("freedb"), QString::fromUtf8("a1107d0a"), testInfo));
+  QVERIFY(!QFile::exists(QDir::homePath()+QString::fromUtf8("/.cddbTest/jazz/a1107d0a")));
+  QVERIFY(QFile::exists(QDir::homePath()+QString::fromUtf8("/.cddbTest/packed.dat")));
+
+  // Storing the entry as a file again replaces the packed one
+  m_client->config().setCacheBackend(Config::EnumCacheBackend::Files);
+  testInfo.set(Title, QString::fromUtf8("Replaced"));
+  Cache::store(m_list, testInfo, m_client->config());
+
+  bool replaced = false;
+  const CDInfoList results = Cache::lookup(m_list, m_client->config());
+  for (const CDInfo &newInfo : results) {
+    if (newInfo.get(Category).toString() == QString::fromUtf8("jazz"))
+      replaced = newInfo.get(Title).toString() == QString::fromUtf8("Replaced");
+  }
+  QVERIFY(replaced);
+
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/jazz/a1107d0a"));
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/jazz/"));
+}
+
+void CacheTest::testPackedCompaction()
+{
+  m_client->config().setCacheBackend(Config::EnumCacheBackend::Packed);
+  m_client->config().setMemoryCacheSize(0);
+
+  CDInfo rockInfo = m_info;
+  rockInfo.set(QString::fromUtf8("source"), QString::fromUtf8("freedb"));
+  rockInfo.set(QString::fromUtf8("discid"), QString::fromUtf8("a1107d0a"));
+  rockInfo.set(QString::fromUtf8("category"), QString::fromUtf8("rock"));
+  Cache::store(m_list, rockInfo, m_client->config());
+
+  // Replacing an entry over and over leaves more than a megabyte of garbage
+  CDInfo jazzInfo = rockInfo;
+  jazzInfo.set(QString::fromUtf8("category"), QString::fromUtf8("jazz"));
+  jazzInfo.set(Comment, QString().leftJustified(40000, QChar('x')));
+  for (int i = 0; i < 40; i++)
+  {
+    jazzInfo.set(Title, QString::number(i));
+    Cache::store(m_list, jazzInfo, m_client->config());
+  }
+
+  QVERIFY(QFileInfo(QDir::homePath()+QString::fromUtf8("/.cddbTest/packed.dat")).size() < 1024 * 1024);
+
+  bool rock = false;
+  bool jazz = false;
+  const CDInfoList results = Cache::lookup(m_list, m_client->config());
+  for (const CDInfo &newInfo : results) {
+    if (newInfo.get(Category).toString() == QString::fromUtf8("rock"))
+      rock = newInfo.get(Title) == m_info.get(Title);
+    if (newInfo.get(Category).toString() == QString::fromUtf8("jazz"))
+      jazz = newInfo.get(Title).toString() == QString::number(39);
+  }
+  QVERIFY(rock);
+  QVERIFY(jazz);
+
+  m_client->config().setMemoryCacheSize(64);
+  m_client->config().setCacheBackend(Config::EnumCacheBackend::Files);
+
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/packed.dat"));
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/packed.idx"));
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/packed.lock"));
+}
+
+void CacheTest::testSharded()
+{
+  m_client->config().setShardedCacheLayout(true);
+
+  CDInfo testInfo = m_info;
+  testInfo.set(QString::fromUtf8("source"), QString::fromUtf8("freedb"));
+  testInfo.set(QString::fromUtf8("discid"), QString::fromUtf8("a1107d0a"));
+  testInfo.set(QString::fromUtf8("category"), QString::fromUtf8("blues"));
+
+  QVERIFY(verify(QString::fromUtf8("freedb"), QString::fromUtf8("a1107d0a"), testInfo));
+  QVERIFY(QFile::exists(QDir::homePath()+QString::fromUtf8("/.cddbTest/blues/a1/10/a1107d0a")));
+
+  // Entries are found while they are sharded, without going through memory
+  m_client->config().setMemoryCacheSize(0);
+
+  bool foundSharded = false;
+  const CDInfoList shardedResults = Cache::lookup(m_list, m_client->config());
+  for (const CDInfo &newInfo : shardedResults) {
+    if (newInfo.get(Category).toString() == QString::fromUtf8("blues"))
+      foundSharded = newInfo.get(Title) == m_info.get(Title);
+  }
+  QVERIFY(foundSharded);
+
+  CDInfo userInfo = m_info;
+  userInfo.set(QString::fromUtf8("source"), QString::fromUtf8("user"));
+  QVERIFY(verify(QString::fromUtf8("user"), QString::fromUtf8("a1107d0a"), userInfo));
+  QVERIFY(QFile::exists(QDir::homePath()+QString::fromUtf8("/.cddbTest/user/a1/10/a1107d0a")));
+
+  m_client->config().setMemoryCacheSize(64);
+
+  // Converting back to the flat layout keeps the entry available
+  m_client->config().setShardedCacheLayout(false);
+  Cache::migrateLayout(m_client->config());
+  QVERIFY(QFile::exists(QDir::homePath()+QString::fromUtf8("/.cddbTest/blues/a1107d0a")));
+  QVERIFY(!QFile::exists(QDir::homePath()+QString::fromUtf8("/.cddbTest/blues/a1/")));
+
+  bool found = false;
+  const CDInfoList results = Cache::lookup(m_list, m_client->config());
+  for (const CDInfo &newInfo : results) {
+    if (newInfo.get(Category).toString() == QString::fromUtf8("blues"))
+      found = true;
+  }
+  QVERIFY(found);
+
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/blues/a1107d0a"));
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/blues/"));
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/user/a1107d0a"));
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/user/"));
+}
+
+void CacheTest::testRelated()
+{
+  // Another disc of the same release, which isn't being looked up
+  TrackOffsetList otherList = m_list;
+  otherList.last() += 75 * 60;
+  const QString freedbId = DiscId::freedbIdString(otherList);
+  const QString musicBrainzId = DiscId::musicBrainzId(otherList);
+
+  CDInfo userInfo = m_info;
+  userInfo.set(QString::fromUtf8("source"), QString::fromUtf8("user"));
+  Cache::store(otherList, userInfo, m_client->config());
+  Cache::storeNegative(otherList, m_client->config());
+  QVERIFY(Cache::lookupNegative(otherList, m_client->config()));
+
+  // Now kept in memory
+  QCOMPARE(Cache::lookup(otherList, m_client->config()).count(), 1);
+
+  CDInfo relatedInfo = m_info;
+  relatedInfo.set(QString::fromUtf8("source"), QString::fromUtf8("musicbrainz"));
+  relatedInfo.set(QString::fromUtf8("discid"), musicBrainzId);
+  Cache::storeRelated(CDInfoList() << relatedInfo, m_client->config());
+
+  QVERIFY(!Cache::lookupNegative(otherList, m_client->config()));
+
+#ifdef HAVE_MUSICBRAINZ
+  bool found = false;
+  const CDInfoList results = Cache::lookup(otherList, m_client->config());
+  for (const CDInfo &newInfo : results) {
+    if (newInfo.get(QString::fromUtf8("source")).toString() == QString::fromUtf8("musicbrainz")
+        && newInfo.get(QString::fromUtf8("discid")).toString() == musicBrainzId)
+      found = newInfo.get(Title) == m_info.get(Title);
+  }
+  QVERIFY(found);
+#endif
+
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/musicbrainz/")+musicBrainzId);
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/musicbrainz/"));
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/user/")+freedbId);
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/user/"));
+  QFile::remove(QDir::homePath()+QString::fromUtf8("/.cddbTest/negative/")+freedbId);
+  QDir().rmdir(QDir::homePath()+QString::fromUtf8("/.cddbTest/negative/"));
+}
+
 QTEST_GUILESS_MAIN(CacheTest)
 
 #include "moc_cachetest.cpp"
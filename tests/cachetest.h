@@ -26,6 +26,14 @@ private Q_SLOTS:
     void testFreedb();
     void testUser();
     void testMusicbrainz();
+    void testIndexRebuild();
+    void testIndexReplaced();
+    void testMemoryCache();
+    void testNegative();
+    void testPacked();
+    void testPackedCompaction();
+    void testSharded();
+    void testRelated();
 private:
     bool verify(const QString& source, const QString& discid, const KCDDB::CDInfo& info);
 
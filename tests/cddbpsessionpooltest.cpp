@@ -0,0 +1,213 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "cddbpsessionpooltest.h"
+#include <QAtomicInt>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThread>
+#include "libkcddb/cddbpsessionpool.h"
+#include "libkcddb/client.h"
+#include "libkcddb/config.h"
+#include "libkcddb/lookup.h"
+
+using namespace KCDDB;
+
+namespace
+{
+    /**
+     * A CDDBP server that knows a single disc, running an event loop on a
+     * thread of its own since the client blocks the test thread
+     */
+    class CDDBPStub
+    {
+    public:
+        CDDBPStub()
+        {
+            m_server.moveToThread(&m_thread);
+            m_thread.start();
+
+            QMetaObject::invokeMethod(&m_server, [this] {
+                QObject::connect(&m_server, &QTcpServer::newConnection, &m_server, [this] {
+                    while (QTcpSocket *socket = m_server.nextPendingConnection())
+                        serve(socket);
+                });
+                m_server.listen(QHostAddress::LocalHost);
+            }, Qt::BlockingQueuedConnection);
+        }
+
+        ~CDDBPStub()
+        {
+            QMetaObject::invokeMethod(&m_server, [this] {
+                m_server.close();
+                qDeleteAll(m_server.findChildren<QTcpSocket *>());
+                m_server.moveToThread(m_thread.thread());
+            }, Qt::BlockingQueuedConnection);
+
+            m_thread.quit();
+            m_thread.wait();
+        }
+
+        quint16 port() const
+        {
+            return m_server.serverPort();
+        }
+
+        int connections() const
+        {
+            return m_connections.loadRelaxed();
+        }
+
+        /**
+         * Hangs up on all sessions, as servers do with idle ones
+         */
+        void dropSessions()
+        {
+            QMetaObject::invokeMethod(&m_server, [this] {
+                const QList<QTcpSocket *> sockets = m_server.findChildren<QTcpSocket *>();
+                for (QTcpSocket *socket : sockets)
+                    socket->disconnectFromHost();
+            }, Qt::BlockingQueuedConnection);
+        }
+
+    private:
+        void serve(QTcpSocket *socket)
+        {
+            m_connections.ref();
+
+            QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            QObject::connect(socket, &QTcpSocket::readyRead, socket, [socket] {
+                while (socket->canReadLine()) {
+                    const QByteArray line = socket->readLine().trimmed();
+
+                    if (line.startsWith("cddb hello "))
+                        socket->write("200 Hello and welcome\r\n");
+                    else if (line.startsWith("proto "))
+                        socket->write("201 OK, CDDB protocol level now: 6\r\n");
+                    else if (line.startsWith("cddb query "))
+                        socket->write("200 misc a1107d0a Artist / Title\r\n");
+                    else if (line == "cddb read misc a1107d0a")
+                        socket->write("210 misc a1107d0a CD database entry follows\r\n"
+                                      "# xmcd\r\n"
+                                      "DISCID=a1107d0a\r\n"
+                                      "DTITLE=Artist / Title\r\n"
+                                      "TTITLE0=Track\r\n"
+                                      ".\r\n");
+                    else if (line == "quit")
+                        socket->disconnectFromHost();
+                    else
+                        socket->write("500 Unrecognized command\r\n");
+                }
+            });
+
+            socket->write("201 stub CDDBP server ready\r\n");
+        }
+
+        QThread m_thread;
+        QTcpServer m_server;
+        QAtomicInt m_connections;
+    };
+
+    Result lookup(const CDDBPStub &stub)
+    {
+        // Keeps the results out of the user's cache
+        static QTemporaryDir cacheDir;
+
+        Client client;
+        client.config().setCacheLocations(QStringList(cacheDir.path()));
+        client.config().setHostname(QStringLiteral("127.0.0.1"));
+        client.config().setPort(stub.port());
+        client.config().setCacheLookupEnabled(false);
+        client.config().setFreedbLookupEnabled(true);
+        client.config().setMusicBrainzLookupEnabled(false);
+        client.config().setFreedbLookupTransport(Lookup::CDDBP);
+
+        TrackOffsetList list;
+        list << 150 << 29462 << 66983 << 96785 << 135628 << 168676
+             << 194147 << 222158 << 247076 << 278203 << 316732;
+
+        const Result result = client.lookup(list);
+        if (Success == result && client.lookupResponse().first().get(Title).toString() != QLatin1String("Title"))
+            return UnknownError;
+
+        return result;
+    }
+}
+
+void CDDBPSessionPoolTest::testReuse()
+{
+    CDDBPStub stub;
+
+    QCOMPARE(lookup(stub), Success);
+    QCOMPARE(lookup(stub), Success);
+    QCOMPARE(lookup(stub), Success);
+
+    // All on the session of the first lookup
+    QCOMPARE(stub.connections(), 1);
+}
+
+void CDDBPSessionPoolTest::testIdleTimeout()
+{
+    CDDBPStub stub;
+    CDDBPSessionPool::setIdleTimeout(100);
+
+    QCOMPARE(lookup(stub), Success);
+    QTest::qWait(200);
+    QCOMPARE(lookup(stub), Success);
+
+    // The first session had been idle too long to be used again
+    QCOMPARE(stub.connections(), 2);
+
+    CDDBPSessionPool::setIdleTimeout(60000);
+}
+
+void CDDBPSessionPoolTest::testDropped()
+{
+    CDDBPStub stub;
+
+    QCOMPARE(lookup(stub), Success);
+
+    stub.dropSessions();
+    QTest::qWait(50);
+
+    // The lookup connects again instead of failing on the pooled session
+    QCOMPARE(lookup(stub), Success);
+    QCOMPARE(stub.connections(), 2);
+}
+
+void CDDBPSessionPoolTest::testSeveralDropped()
+{
+    CDDBPStub stub;
+    const QString host = QStringLiteral("127.0.0.1");
+
+    QList<QTcpSocket *> sockets;
+    for (int i = 0; i < 3; ++i) {
+        QTcpSocket *socket = new QTcpSocket;
+        socket->connectToHost(host, stub.port());
+        QVERIFY(socket->waitForConnected());
+        QVERIFY(socket->waitForReadyRead());
+        socket->readAll();
+
+        CDDBPSessionPool::release(host, stub.port(), socket);
+        sockets << socket;
+    }
+
+    // The two most recently used sessions are gone
+    sockets.at(1)->abort();
+    sockets.at(2)->abort();
+
+    QTcpSocket *socket = CDDBPSessionPool::take(host, stub.port());
+    QCOMPARE(socket, sockets.at(0));
+    delete socket;
+
+    QVERIFY(!CDDBPSessionPool::take(host, stub.port()));
+}
+
+QTEST_GUILESS_MAIN(CDDBPSessionPoolTest)
+
+#include "moc_cddbpsessionpooltest.cpp"
@@ -0,0 +1,22 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef CDDBPSESSIONPOOLTEST_H
+#define CDDBPSESSIONPOOLTEST_H
+
+#include <QObject>
+
+class CDDBPSessionPoolTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testReuse();
+    void testIdleTimeout();
+    void testDropped();
+    void testSeveralDropped();
+};
+
+#endif
@@ -7,6 +7,7 @@
 #include "cdinfotest.h"
 #include <QTest>
 #include "libkcddb/cdinfo.h"
+#include "libkcddb/cdinfoparser.h"
 
 using namespace KCDDB;
 
@@ -74,6 +75,183 @@ void CDInfoTest::testLongLines()
     }
 }
 
+void CDInfoTest::testLoad()
+{
+    CDInfo info;
+    info.load(QString::fromUtf8(
+        "# xmcd\r\n"
+        "# Revision: 7\r\n"
+        "DISCID=a1107d0a\r\n"
+        "DTITLE=Some Artist / Some\r\n"
+        "DTITLE= Title\r\n"
+        "DYEAR=1998\r\n"
+        "DGENRE=\r\n"
+        "TTITLE0=First\r\n"
+        "TTITLE1=Second\r\n"
+        "EXTD=Line\\none\\\\nnot a line\r\n"
+        "EXTT1=Tab\\there\r\n"
+        "TMOOD_1=calm\r\n"
+        "TMOOD_01=ignored\r\n"
+        "SOMETHING=custom = value\r\n"));
+
+    QCOMPARE(info.get(QString::fromUtf8("revision")).toInt(), 7);
+    QCOMPARE(info.get(QString::fromUtf8("discid")).toString(), QString::fromUtf8("a1107d0a"));
+    QCOMPARE(info.get(Artist).toString(), QString::fromUtf8("Some Artist"));
+    QCOMPARE(info.get(Title).toString(), QString::fromUtf8("Some Title"));
+    QCOMPARE(info.get(Year).toString(), QString::fromUtf8("1998"));
+    QCOMPARE(info.get(Genre).toString(), QString::fromUtf8("Unknown"));
+    QCOMPARE(info.get(Comment).toString(), QString::fromUtf8("Line\none\\nnot a line"));
+    QCOMPARE(info.get(QString::fromUtf8("something")).toString(), QString::fromUtf8("custom = value"));
+
+    QCOMPARE(info.numberOfTracks(), 2);
+    QCOMPARE(info.track(0).get(Title).toString(), QString::fromUtf8("First"));
+    QCOMPARE(info.track(0).get(Artist).toString(), QString::fromUtf8("Some Artist"));
+    QCOMPARE(info.track(1).get(Comment).toString(), QString::fromUtf8("Tab\there"));
+    QCOMPARE(info.track(1).get(QString::fromUtf8("mood")).toString(), QString::fromUtf8("calm"));
+
+    // Loading what toString() wrote gives back the same entry
+    CDInfo info2;
+    info2.load(info.toString());
+    QCOMPARE(info2.get(Comment).toString(), info.get(Comment).toString());
+    QCOMPARE(info2.track(1).get(QString::fromUtf8("mood")).toString(), QString::fromUtf8("calm"));
+}
+
+void CDInfoTest::testLoadUtf8()
+{
+    const QString data = QString::fromUtf8(
+        "DISCID=13093f02\n"
+        "DTITLE=神城麻郁 / ドラマアルバム\n"
+        "TTITLE0=第EX話 おねがい☆全員集合\n"
+        "EXTT0=Zwölf\\tBoxkämpfer\n"
+        "TÄRGER_0=ü\n");
+
+    CDInfo info;
+    info.load(data);
+
+    CDInfo info2;
+    info2.loadUtf8(data.toUtf8());
+
+    QVERIFY(info == info2);
+    QCOMPARE(info2.get(Artist).toString(), QString::fromUtf8("神城麻郁"));
+    QCOMPARE(info2.track(0).get(Title).toString(), QString::fromUtf8("第EX話 おねがい☆全員集合"));
+    QCOMPARE(info2.track(0).get(Comment).toString(), QString::fromUtf8("Zwölf\tBoxkämpfer"));
+    QCOMPARE(info2.track(0).get(QString::fromUtf8("Ärger")).toString(), QString::fromUtf8("ü"));
+}
+
+void CDInfoTest::testCopies()
+{
+    CDInfo info;
+    info.set(Title, QString::fromUtf8("Original"));
+    info.track(0).set(Title, QString::fromUtf8("Track"));
+
+    // Changing a copy leaves the original alone
+    CDInfo copy(info);
+    QVERIFY(copy == info);
+    copy.set(Title, QString::fromUtf8("Changed"));
+    copy.track(0).set(Title, QString::fromUtf8("Changed"));
+    QCOMPARE(info.get(Title).toString(), QString::fromUtf8("Original"));
+    QCOMPARE(info.track(0).get(Title).toString(), QString::fromUtf8("Track"));
+    QVERIFY(copy != info);
+
+    TrackInfo track = info.track(0);
+    track.set(Artist, QString::fromUtf8("Someone"));
+    QVERIFY(info.track(0).get(Artist).toString().isEmpty());
+
+    CDInfo moved(std::move(copy));
+    QCOMPARE(moved.get(Title).toString(), QString::fromUtf8("Changed"));
+    copy = info;
+    QVERIFY(copy == info);
+}
+
+void CDInfoTest::testFields()
+{
+    CDInfo info;
+    info.set(Title, QString::fromUtf8("Title"));
+    QCOMPARE(info.get(QString::fromUtf8("tItLe")).toString(), QString::fromUtf8("Title"));
+    info.set(QString::fromUtf8("discid"), QString::fromUtf8("a1107d0a"));
+    QCOMPARE(info.get(QString::fromUtf8("DISCID")).toString(), QString::fromUtf8("a1107d0a"));
+
+    // Reserved keys are refused
+    info.set(QString::fromUtf8("dtitle"), QString::fromUtf8("Nope"));
+    info.set(QString::fromUtf8("TFOO_1"), QString::fromUtf8("Nope"));
+    QVERIFY(!info.get(QString::fromUtf8("dtitle")).isValid());
+    QVERIFY(!info.get(QString::fromUtf8("TFOO_1")).isValid());
+
+    // Custom data is written in the order of its keys, around the fields
+    info.set(QString::fromUtf8("zebra"), QString::fromUtf8("z"));
+    info.set(QString::fromUtf8("length"), QString::fromUtf8("42"));
+    info.set(QString::fromUtf8("apple"), QString::fromUtf8("a"));
+    const QString data = info.toString();
+    QVERIFY(data.indexOf(QString::fromUtf8("APPLE=a")) < data.indexOf(QString::fromUtf8("LENGTH=42")));
+    QVERIFY(data.indexOf(QString::fromUtf8("LENGTH=42")) < data.indexOf(QString::fromUtf8("ZEBRA=z")));
+
+    TrackInfo& track = info.track(0);
+    track.set(QString::fromUtf8("mood"), QString::fromUtf8("calm"));
+    track.set(Year, 1998);
+    QVERIFY(track.toString().contains(QString::fromUtf8("TMOOD_0=calm")));
+    QVERIFY(track.toString().contains(QString::fromUtf8("TYEAR_0=1998")));
+
+    CDInfo info2;
+    info2.load(info.toString());
+    QCOMPARE(info2.get(QString::fromUtf8("apple")).toString(), QString::fromUtf8("a"));
+    QCOMPARE(info2.track(0).get(QString::fromUtf8("mood")).toString(), QString::fromUtf8("calm"));
+}
+
+void CDInfoTest::testSplitLines()
+{
+    // Escapes, multi-byte characters and surrogate pairs straddling the
+    // point where a line has to be split
+    QString comment;
+    for (int i = 0; i < 300; ++i)
+        comment += QString::fromUtf8("a\tä\\€\n𝄞");
+
+    CDInfo info;
+    info.set(Comment, comment);
+    info.track(0).set(Comment, comment);
+
+    const QByteArray data = info.toUtf8();
+    QCOMPARE(QString::fromUtf8(data), info.toString());
+
+    const QList<QByteArray> lines = data.split('\n');
+    for (const QByteArray &line : lines)
+        QVERIFY(line.size() <= 256);
+
+    CDInfo info2;
+    info2.loadUtf8(data);
+    QCOMPARE(info2.get(Comment).toString(), comment);
+    QCOMPARE(info2.track(0).get(Comment).toString(), comment);
+}
+
+void CDInfoTest::testFeed()
+{
+    CDInfo info;
+    info.set(QString::fromUtf8("discid"), QString::fromUtf8("a1107d0a"));
+    info.set(Artist, QString::fromUtf8("Artïst"));
+    info.set(Title, QString::fromUtf8("Tïtle"));
+    info.set(Comment, QString(1000, QChar(0x20ac)));
+    info.track(0).set(Title, QString::fromUtf8("Träck"));
+
+    const QByteArray entry = info.toUtf8();
+    const QByteArray response = "210 misc a1107d0a\r\n" + entry + ".\r\n210 next response\r\n";
+
+    // Chunks may end anywhere, even within a character
+    for (int chunkSize = 1; chunkSize < 8; ++chunkSize)
+    {
+        CDInfo fed;
+        CDInfoParser parser(fed);
+
+        int used = 0;
+        while (!parser.isFinished() && used < response.size())
+            used += parser.feed(response.mid(used, chunkSize));
+
+        QVERIFY(parser.isFinished());
+        QCOMPARE(response.mid(used), QByteArray("210 next response\r\n"));
+        QCOMPARE(fed.get(Artist).toString(), info.get(Artist).toString());
+        QCOMPARE(fed.get(Comment).toString(), info.get(Comment).toString());
+        QCOMPARE(fed.track(0).get(Title).toString(), QString::fromUtf8("Träck"));
+    }
+}
+
 QTEST_GUILESS_MAIN(CDInfoTest)
 
 #include "moc_cdinfotest.cpp"
@@ -14,6 +14,12 @@ class CDInfoTest : public QObject
     Q_OBJECT
 private Q_SLOTS:
     void testLongLines();
+    void testLoad();
+    void testLoadUtf8();
+    void testCopies();
+    void testFields();
+    void testSplitLines();
+    void testFeed();
 };
 
 #endif
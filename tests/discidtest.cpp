@@ -0,0 +1,104 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "discidtest.h"
+#include <QTest>
+#include "libkcddb/cddb.h"
+#include "libkcddb/discid.h"
+#include "libkcddb/discsignature.h"
+
+using namespace KCDDB;
+
+void DiscIdTest::testIds_data()
+{
+    QTest::addColumn<TrackOffsetList>("list");
+    QTest::addColumn<QString>("freedbId");
+    QTest::addColumn<QString>("musicBrainzId");
+
+    // The Liptones / The Latest News
+    QTest::newRow("15 tracks") << (TrackOffsetList() << 150 << 9219 << 20386 << 34134 << 51437
+                                    << 68809 << 86591 << 106288 << 115568 << 133312 << 155593
+                                    << 169832 << 179626 << 194958 << 212506)
+                               << QString::fromUtf8("c20b0f0e")
+                               << QString::fromUtf8("HN1R_6lN8vOu6wvEjjgGiy_KEXg-");
+
+    QTest::newRow("5 tracks") << (TrackOffsetList() << 150 << 106965 << 127220 << 151925 << 176085 << 234500)
+                              << QString::fromUtf8("3e0c3405")
+                              << QString::fromUtf8("6LLfeqJeonIK0TNr1.t4flFS59Q-");
+}
+
+void DiscIdTest::testIds()
+{
+    QFETCH(TrackOffsetList, list);
+    QFETCH(QString, freedbId);
+    QFETCH(QString, musicBrainzId);
+
+    QCOMPARE(DiscId::freedbIdString(list), freedbId);
+    QCOMPARE(DiscId::freedbId(list), freedbId.toUInt(nullptr, 16));
+    QCOMPARE(CDDB::trackOffsetListToId(list), freedbId);
+    QCOMPARE(DiscId::musicBrainzId(list), musicBrainzId);
+}
+
+void DiscIdTest::testEmpty()
+{
+    QCOMPARE(DiscId::freedbId(TrackOffsetList()), 0u);
+    QVERIFY(DiscId::freedbIdString(TrackOffsetList()).isNull());
+    QVERIFY(DiscId::musicBrainzId(TrackOffsetList()).isNull());
+
+    const QList<DiscIds> ids = DiscId::calculate(QList<TrackOffsetList>() << TrackOffsetList());
+    QCOMPARE(ids.count(), 1);
+    QCOMPARE(ids.first().freedbId, 0u);
+    QVERIFY(ids.first().freedbIdString().isEmpty());
+    QVERIFY(ids.first().musicBrainzIdString().isEmpty());
+}
+
+void DiscIdTest::testBatch()
+{
+    QList<TrackOffsetList> lists;
+    for (int tracks = 1; tracks <= 99; ++tracks)
+    {
+        TrackOffsetList list;
+        for (int i = 0; i <= tracks; ++i)
+            list << 150 + i * 13577 + tracks;
+        lists << list;
+    }
+
+    const QList<DiscIds> ids = DiscId::calculate(lists);
+    QCOMPARE(ids.count(), lists.count());
+
+    for (int i = 0; i < lists.count(); ++i)
+    {
+        QCOMPARE(ids[i].freedbId, DiscId::freedbId(lists[i]));
+        QCOMPARE(ids[i].freedbIdString(), DiscId::freedbIdString(lists[i]));
+        QCOMPARE(ids[i].musicBrainzIdString(), DiscId::musicBrainzId(lists[i]));
+    }
+}
+
+void DiscIdTest::testSignature()
+{
+    const TrackOffsetList list = TrackOffsetList() << 150 << 106965 << 127220 << 151925 << 176085 << 234500;
+
+    const DiscSignature signature(list);
+    QCOMPARE(signature.trackOffsetList(), list);
+    QCOMPARE(signature.numberOfTracks(), 5);
+    QCOMPARE(signature.freedbId(), QString::fromUtf8("3e0c3405"));
+    QCOMPARE(signature.musicBrainzId(), QString::fromUtf8("6LLfeqJeonIK0TNr1.t4flFS59Q-"));
+    QCOMPARE(signature.queryString(), QString::fromUtf8("5 150 106965 127220 151925 176085 3126"));
+
+    const DiscSignature copy = signature;
+    QVERIFY(copy == signature);
+    QVERIFY(copy != DiscSignature(TrackOffsetList() << 150 << 106965));
+
+    const DiscSignature empty;
+    QVERIFY(empty.isEmpty());
+    QCOMPARE(empty.numberOfTracks(), 0);
+    QVERIFY(empty.freedbId().isEmpty());
+    QVERIFY(empty.queryString().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(DiscIdTest)
+
+#include "moc_discidtest.cpp"
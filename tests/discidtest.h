@@ -0,0 +1,23 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef DISCIDTEST_H
+#define DISCIDTEST_H
+
+#include <QObject>
+
+class DiscIdTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testIds_data();
+    void testIds();
+    void testEmpty();
+    void testBatch();
+    void testSignature();
+};
+
+#endif
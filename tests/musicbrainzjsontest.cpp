@@ -0,0 +1,137 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "musicbrainzjsontest.h"
+#include <QTest>
+#include "libkcddb/cdinfo.h"
+#include "libkcddb/musicbrainz/musicbrainzjson.h"
+
+using namespace KCDDB;
+
+namespace
+{
+    const QString discId = QString::fromUtf8("wdABQ7s86gS7eVmS74CCQ6KwPUI-");
+
+    // Shaped like a response to /ws/2/discid/<id>?inc=recordings+artist-credits&fmt=json
+    const QByteArray discResponse =
+        "{\"id\": \"wdABQ7s86gS7eVmS74CCQ6KwPUI-\", \"sectors\": 225000, \"offsets\": [150, 20000],\n"
+        " \"releases\": [\n"
+        "  {\"id\": \"r1\", \"title\": \"Two \\\"Sides\\\"\", \"date\": \"1998-05-12\", \"status\": null,\n"
+        "   \"text-representation\": {\"language\": \"swe\", \"script\": \"Latn\"},\n"
+        "   \"artist-credit\": [{\"name\": \"M\\u00e4n\", \"joinphrase\": \" & \", \"artist\": {\"name\": \"Men\"}},\n"
+        "                       {\"name\": \"\", \"joinphrase\": \"\", \"artist\": {\"name\": \"Women\"}}],\n"
+        "   \"media\": [\n"
+        "    {\"position\": 1, \"format\": \"CD\", \"discs\": [{\"id\": \"other\"}], \"tracks\": [{\"title\": \"Disc one\"}]},\n"
+        "    {\"position\": 2, \"discs\": [{\"id\": \"wdABQ7s86gS7eVmS74CCQ6KwPUI-\", \"offsets\": [150]}],\n"
+        "     \"tracks\": [\n"
+        "      {\"position\": 1, \"title\": \"First\", \"length\": 12345.5,\n"
+        "       \"recording\": {\"title\": \"First recording\", \"video\": false,\n"
+        "                     \"artist-credit\": [{\"name\": \"Recording artist\", \"joinphrase\": \"\"}]}},\n"
+        "      {\"position\": 2, \"title\": \"\",\n"
+        "       \"artist-credit\": [{\"name\": \"Track artist\", \"joinphrase\": \"\"}],\n"
+        "       \"recording\": {\"title\": \"Second recording\"}}]}]},\n"
+        "  {\"id\": \"r2\", \"title\": \"Single\", \"date\": \"2001\",\n"
+        "   \"artist-credit\": [{\"name\": \"Solo\", \"joinphrase\": \"\"}],\n"
+        "   \"media\": [{\"position\": 1, \"discs\": [{\"id\": \"wdABQ7s86gS7eVmS74CCQ6KwPUI-\"}],\n"
+        "              \"tracks\": [{\"title\": \"Only\", \"artist-credit\": [{\"name\": \"Solo\"}]}]}]}\n"
+        " ]}\n";
+}
+
+void MusicBrainzJsonTest::testDisc()
+{
+    QList<MusicBrainzJson::Release> releases;
+    QVERIFY(MusicBrainzJson::readDisc(discResponse, discId, releases));
+    QCOMPARE(releases.count(), 2);
+
+    const MusicBrainzJson::Release &first = releases.at(0);
+    QCOMPARE(first.id, QString::fromUtf8("r1"));
+    QVERIFY(first.complete);
+    QCOMPARE(first.media.count(), 1);
+
+    const CDInfo &info = first.media.first();
+    QCOMPARE(info.get(QString::fromUtf8("source")).toString(), QString::fromUtf8("musicbrainz"));
+    QCOMPARE(info.get(Artist).toString(), QString::fromUtf8("Män & Women"));
+    QCOMPARE(info.get(Year).toInt(), 1998);
+    QVERIFY(info.get(Title).toString().contains(QString::fromUtf8("Two \"Sides\"")));
+    QCOMPARE(info.numberOfTracks(), 2);
+
+    // Without credits of its own the track takes the recording's
+    QCOMPARE(info.track(0).get(Title).toString(), QString::fromUtf8("First"));
+    QCOMPARE(info.track(0).get(Artist).toString(), QString::fromUtf8("Recording artist"));
+    // Without a title of its own the track takes the recording's
+    QCOMPARE(info.track(1).get(Title).toString(), QString::fromUtf8("Second recording"));
+    QCOMPARE(info.track(1).get(Artist).toString(), QString::fromUtf8("Track artist"));
+
+    // The other disc of the release, for the cache
+    QCOMPARE(first.otherMedia.count(), 1);
+    const CDInfo &other = first.otherMedia.first();
+    QCOMPARE(other.get(QString::fromUtf8("discid")).toString(), QString::fromUtf8("other"));
+    QCOMPARE(other.get(Artist).toString(), QString::fromUtf8("Män & Women"));
+    QCOMPARE(other.numberOfTracks(), 1);
+    QCOMPARE(other.track(0).get(Title).toString(), QString::fromUtf8("Disc one"));
+
+    const MusicBrainzJson::Release &second = releases.at(1);
+    QVERIFY(second.complete);
+    QCOMPARE(second.media.count(), 1);
+    QVERIFY(second.otherMedia.isEmpty());
+    QCOMPARE(second.media.first().get(Title).toString(), QString::fromUtf8("Single"));
+    QCOMPARE(second.media.first().get(Year).toInt(), 2001);
+    QCOMPARE(second.media.first().track(0).get(Artist).toString(), QString::fromUtf8("Solo"));
+}
+
+void MusicBrainzJsonTest::testIncompleteRelease()
+{
+    const QByteArray response =
+        "{\"releases\": [{\"id\": \"r1\", \"title\": \"No tracks\","
+        " \"media\": [{\"position\": 1, \"discs\": [{\"id\": \"wdABQ7s86gS7eVmS74CCQ6KwPUI-\"}]}]}]}";
+
+    QList<MusicBrainzJson::Release> releases;
+    QVERIFY(MusicBrainzJson::readDisc(response, discId, releases));
+    QCOMPARE(releases.count(), 1);
+    QVERIFY(!releases.first().complete);
+    QVERIFY(releases.first().media.isEmpty());
+
+    // What the release query returns instead
+    const QByteArray releaseResponse =
+        "{\"id\": \"r1\", \"title\": \"No tracks\", \"artist-credit\": [],"
+        " \"media\": [{\"position\": 1, \"discs\": [{\"id\": \"wdABQ7s86gS7eVmS74CCQ6KwPUI-\"}],"
+        " \"tracks\": [{\"title\": \"Found\"}]}]}";
+
+    MusicBrainzJson::Release release;
+    QVERIFY(MusicBrainzJson::readRelease(releaseResponse, discId, release));
+    QVERIFY(release.complete);
+    QCOMPARE(release.media.count(), 1);
+    QCOMPARE(release.media.first().track(0).get(Title).toString(), QString::fromUtf8("Found"));
+}
+
+void MusicBrainzJsonTest::testMediaCount()
+{
+    // A disc id lookup may only list the media with the disc on them
+    const QByteArray response =
+        "{\"releases\": [{\"id\": \"r1\", \"title\": \"Box\", \"media-count\": 3,"
+        " \"media\": [{\"position\": 2, \"discs\": [{\"id\": \"wdABQ7s86gS7eVmS74CCQ6KwPUI-\"}, {\"id\": \"same\"}],"
+        " \"tracks\": [{\"title\": \"Only\"}]}]}]}";
+
+    QList<MusicBrainzJson::Release> releases;
+    QVERIFY(MusicBrainzJson::readDisc(response, discId, releases));
+    QCOMPARE(releases.count(), 1);
+    QCOMPARE(releases.first().media.count(), 1);
+    QCOMPARE(releases.first().media.first().get(Title).toString(), QString::fromUtf8("Box (disc 2)"));
+
+    // Other discs of the same medium aren't other media
+    QVERIFY(releases.first().otherMedia.isEmpty());
+}
+
+void MusicBrainzJsonTest::testInvalid()
+{
+    QList<MusicBrainzJson::Release> releases;
+    QVERIFY(!MusicBrainzJson::readDisc("{\"releases\": [{\"id\": \"r1\", \"title\": \"Cut", discId, releases));
+    QVERIFY(!MusicBrainzJson::readDisc("<html>Service unavailable</html>", discId, releases));
+}
+
+QTEST_GUILESS_MAIN(MusicBrainzJsonTest)
+
+#include "moc_musicbrainzjsontest.cpp"
@@ -0,0 +1,22 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef MUSICBRAINZJSONTEST_H
+#define MUSICBRAINZJSONTEST_H
+
+#include <QObject>
+
+class MusicBrainzJsonTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testDisc();
+    void testIncompleteRelease();
+    void testMediaCount();
+    void testInvalid();
+};
+
+#endif
@@ -0,0 +1,189 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "musicbrainzschedulertest.h"
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QTest>
+#include <QThread>
+#include "libkcddb/client.h"
+#include "libkcddb/config.h"
+#include "libkcddb/musicbrainz/musicbrainzscheduler.h"
+#include "config-musicbrainz.h"
+
+using namespace KCDDB;
+
+void MusicBrainzSchedulerTest::init()
+{
+    MusicBrainzScheduler::setInterval(100);
+    MusicBrainzScheduler::reportSuccess();
+    // Use up the slot left over from the previous test
+    MusicBrainzScheduler::acquire(MusicBrainzScheduler::Interactive);
+}
+
+void MusicBrainzSchedulerTest::testPacing()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < 4; ++i)
+        MusicBrainzScheduler::acquire(MusicBrainzScheduler::Interactive);
+
+    // Evenly spaced, not in a burst
+    QVERIFY(timer.elapsed() >= 390);
+}
+
+void MusicBrainzSchedulerTest::testPriority()
+{
+    // Leave enough time to queue both requests before the next slot
+    MusicBrainzScheduler::setInterval(1000);
+    MusicBrainzScheduler::acquire(MusicBrainzScheduler::Interactive);
+
+    QMutex mutex;
+    QStringList order;
+
+    QThread *batch = QThread::create([&] {
+        MusicBrainzScheduler::acquire(MusicBrainzScheduler::Batch);
+        QMutexLocker locker(&mutex);
+        order << QStringLiteral("batch");
+    });
+    batch->start();
+    QTRY_COMPARE(MusicBrainzScheduler::stats().queuedBatch, 1);
+
+    QThread *interactive = QThread::create([&] {
+        MusicBrainzScheduler::acquire(MusicBrainzScheduler::Interactive);
+        QMutexLocker locker(&mutex);
+        order << QStringLiteral("interactive");
+    });
+    interactive->start();
+
+    QVERIFY(batch->wait(5000));
+    QVERIFY(interactive->wait(5000));
+    delete batch;
+    delete interactive;
+
+    QCOMPARE(order, QStringList() << QStringLiteral("interactive") << QStringLiteral("batch"));
+    QCOMPARE(MusicBrainzScheduler::stats().queuedInteractive, 0);
+    QCOMPARE(MusicBrainzScheduler::stats().queuedBatch, 0);
+}
+
+void MusicBrainzSchedulerTest::testBackoff()
+{
+    const quint64 throttled = MusicBrainzScheduler::stats().throttled;
+
+    MusicBrainzScheduler::reportThrottled();
+    MusicBrainzScheduler::reportThrottled();
+
+    const MusicBrainzScheduler::Stats stats = MusicBrainzScheduler::stats();
+    QCOMPARE(stats.throttled, throttled + 2);
+    QCOMPARE(stats.backoff, 200);
+
+    QElapsedTimer timer;
+    timer.start();
+    MusicBrainzScheduler::acquire(MusicBrainzScheduler::Interactive);
+    QVERIFY(timer.elapsed() >= 190);
+
+    MusicBrainzScheduler::reportSuccess();
+    QCOMPARE(MusicBrainzScheduler::stats().backoff, 0);
+}
+
+void MusicBrainzSchedulerTest::testCancel()
+{
+    // Leave enough time to queue and cancel the requests before the next slot
+    MusicBrainzScheduler::setInterval(2000);
+    MusicBrainzScheduler::acquire(MusicBrainzScheduler::Interactive);
+
+    QAtomicInt cancelled[3];
+    bool acquired[3] = { true, true, false };
+    QList<QThread *> threads;
+    for (int i = 0; i < 3; ++i) {
+        threads << QThread::create([&, i] {
+            acquired[i] = MusicBrainzScheduler::acquire(MusicBrainzScheduler::Interactive, &cancelled[i]);
+        });
+        threads.last()->start();
+        QTRY_COMPARE(MusicBrainzScheduler::stats().queuedInteractive, i + 1);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // One that waits behind another, then the one whose turn it is
+    cancelled[1].storeRelease(1);
+    MusicBrainzScheduler::wakeUp();
+    QVERIFY(threads.at(1)->wait(1000));
+    cancelled[0].storeRelease(1);
+    MusicBrainzScheduler::wakeUp();
+    QVERIFY(threads.at(0)->wait(1000));
+    QVERIFY(timer.elapsed() < 1500);
+
+    // The last one doesn't wait for the turns of the others
+    QVERIFY(threads.at(2)->wait(5000));
+    qDeleteAll(threads);
+
+    QVERIFY(!acquired[0]);
+    QVERIFY(!acquired[1]);
+    QVERIFY(acquired[2]);
+    QCOMPARE(MusicBrainzScheduler::stats().queuedInteractive, 0);
+}
+
+void MusicBrainzSchedulerTest::testLookupPriority()
+{
+#ifndef HAVE_MUSICBRAINZ
+    QSKIP("This test requires MusicBrainz support", SkipAll);
+#endif
+
+    // Nothing listens there, the lookups fail as soon as they are let through
+    const QString server = QStringLiteral("http://127.0.0.1:1");
+
+    TrackOffsetList list;
+    list << 150 << 29462 << 66983 << 96785 << 135628 << 316732;
+
+    // Hold all requests back while the lookups queue up
+    MusicBrainzScheduler::setInterval(3000);
+    MusicBrainzScheduler::acquire(MusicBrainzScheduler::Interactive);
+
+    // More batch lookups than there are threads for them
+    QList<Client *> clients;
+    for (int i = 0; i < 8; ++i)
+    {
+        Client *client = new Client;
+        client->config().setCacheLookupEnabled(false);
+        client->config().setFreedbLookupEnabled(false);
+        client->config().setMusicBrainzLookupEnabled(true);
+        client->config().setMusicBrainzServer(server);
+        client->setBlockingMode(false);
+        client->setBatchMode(true);
+        client->lookup(list);
+        clients << client;
+    }
+    QTRY_VERIFY(MusicBrainzScheduler::stats().queuedBatch > 0);
+
+    Client *interactive = new Client;
+    interactive->config().setCacheLookupEnabled(false);
+    interactive->config().setFreedbLookupEnabled(false);
+    interactive->config().setMusicBrainzLookupEnabled(true);
+    interactive->config().setMusicBrainzServer(server);
+    interactive->setBlockingMode(false);
+    interactive->lookup(list);
+    clients << interactive;
+
+    // The interactive lookup reaches the scheduler before the next slot,
+    // instead of waiting for a thread the batch lookups hold
+    QTRY_COMPARE_WITH_TIMEOUT(MusicBrainzScheduler::stats().queuedInteractive, 1, 2000);
+
+    MusicBrainzScheduler::setInterval(0);
+    qDeleteAll(clients);
+
+    QTRY_COMPARE_WITH_TIMEOUT(MusicBrainzScheduler::stats().queuedInteractive, 0, 10000);
+    QTRY_COMPARE_WITH_TIMEOUT(MusicBrainzScheduler::stats().queuedBatch, 0, 10000);
+}
+
+QTEST_GUILESS_MAIN(MusicBrainzSchedulerTest)
+
+#include "moc_musicbrainzschedulertest.cpp"
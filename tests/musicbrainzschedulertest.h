@@ -0,0 +1,24 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef MUSICBRAINZSCHEDULERTEST_H
+#define MUSICBRAINZSCHEDULERTEST_H
+
+#include <QObject>
+
+class MusicBrainzSchedulerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void testPacing();
+    void testPriority();
+    void testBackoff();
+    void testCancel();
+    void testLookupPriority();
+};
+
+#endif
@@ -15,8 +15,8 @@ void MusicBrainzTestFullDate::testLookup()
 {
   using namespace KCDDB;
 
-#ifndef HAVE_MUSICBRAINZ5
-  QSKIP("This test requires libmusicbrainz", SkipAll);
+#ifndef HAVE_MUSICBRAINZ
+  QSKIP("This test requires MusicBrainz support", SkipAll);
 #endif
 
   Client c;
@@ -21,8 +21,8 @@ void MusicBrainzTestSeveralDiscs::testLookup()
 {
   using namespace KCDDB;
 
-#ifndef HAVE_MUSICBRAINZ5
-  QSKIP("This test requires libmusicbrainz", SkipAll);
+#ifndef HAVE_MUSICBRAINZ
+  QSKIP("This test requires MusicBrainz support", SkipAll);
 #endif
 
   Client c;
@@ -76,6 +76,12 @@ void SyncCDDBLookupTest::testLookup()
   }
 
   QVERIFY(hasRunTest);
+
+  // The second lookup reuses the session of the first one
+  r = c.lookup(list);
+
+  QVERIFY(r == Success);
+  QCOMPARE(c.lookupResponse().count(), response.count());
 }
 
 QTEST_GUILESS_MAIN(SyncCDDBLookupTest)
@@ -0,0 +1,255 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "synchttpclienttest.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSemaphore>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTest>
+#include <QThread>
+#include <QUrl>
+#include "libkcddb/synchttpclient.h"
+
+using namespace KCDDB;
+
+namespace
+{
+    /**
+     * Answers the requests it gets with canned responses, one per request,
+     * on a thread of its own since the client blocks the test thread
+     */
+    class HTTPStub : public QThread
+    {
+    public:
+        enum Action
+        {
+            // Send the response and keep the connection open
+            KeepOpen,
+            // Send the response and close the connection
+            Close,
+            // Close the connection without answering
+            Drop
+        };
+
+        ~HTTPStub() override
+        {
+            wait();
+        }
+
+        void answer(const QByteArray &response, Action action = KeepOpen)
+        {
+            m_responses << qMakePair(response, action);
+        }
+
+        quint16 listen()
+        {
+            start();
+            m_ready.acquire();
+            return m_port;
+        }
+
+        QUrl url(const QString &path) const
+        {
+            return QUrl(QStringLiteral("http://127.0.0.1:%1%2").arg(m_port).arg(path));
+        }
+
+        QList<QByteArray> requests() const
+        {
+            QMutexLocker locker(&m_mutex);
+            return m_requests;
+        }
+
+        int connections() const
+        {
+            QMutexLocker locker(&m_mutex);
+            return m_connections;
+        }
+
+    protected:
+        void run() override
+        {
+            QTcpServer server;
+            server.listen(QHostAddress::LocalHost);
+            m_port = server.serverPort();
+            m_ready.release();
+
+            QTcpSocket *socket = nullptr;
+
+            for (const auto &response : qAsConst(m_responses)) {
+                QByteArray request;
+
+                while (!request.contains("\r\n\r\n")) {
+                    if (!socket || (socket->state() != QAbstractSocket::ConnectedState && !socket->bytesAvailable())) {
+                        delete socket;
+                        socket = nullptr;
+                        if (!server.waitForNewConnection(5000))
+                            return;
+                        socket = server.nextPendingConnection();
+                        QMutexLocker locker(&m_mutex);
+                        ++m_connections;
+                    }
+
+                    if (!socket->bytesAvailable() && !socket->waitForReadyRead(5000)
+                        && socket->state() == QAbstractSocket::ConnectedState) {
+                        delete socket;
+                        return;
+                    }
+                    request += socket->readAll();
+                }
+
+                {
+                    QMutexLocker locker(&m_mutex);
+                    m_requests << request;
+                }
+
+                if (response.second != Drop) {
+                    socket->write(response.first);
+                    socket->waitForBytesWritten(5000);
+                }
+
+                if (response.second != KeepOpen) {
+                    socket->disconnectFromHost();
+                    if (socket->state() != QAbstractSocket::UnconnectedState)
+                        socket->waitForDisconnected(5000);
+                    delete socket;
+                    socket = nullptr;
+                }
+            }
+
+            delete socket;
+        }
+
+    private:
+        QList<QPair<QByteArray, Action>> m_responses;
+        QSemaphore m_ready;
+        quint16 m_port = 0;
+
+        mutable QMutex m_mutex;
+        QList<QByteArray> m_requests;
+        int m_connections = 0;
+    };
+}
+
+void SyncHTTPClientTest::testContentLength()
+{
+    HTTPStub stub;
+    stub.answer("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello");
+    stub.listen();
+
+    QByteArray data;
+    int status;
+    QVERIFY(SyncHTTPClient::get(stub.url(QStringLiteral("/path?query=1")), data, &status));
+    QCOMPARE(status, 200);
+    QCOMPARE(data, QByteArray("hello"));
+
+    QVERIFY(stub.wait(5000));
+    QVERIFY(stub.requests().first().startsWith("GET /path?query=1 HTTP/1.1\r\n"));
+}
+
+void SyncHTTPClientTest::testChunked()
+{
+    HTTPStub stub;
+    stub.answer("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                "5;name=value\r\nhello\r\n6\r\n world\r\n0\r\nX-Trailer: 1\r\n\r\n");
+    stub.listen();
+
+    QByteArray data;
+    QVERIFY(SyncHTTPClient::get(stub.url(QStringLiteral("/")), data));
+    QCOMPARE(data, QByteArray("hello world"));
+
+    QVERIFY(stub.wait(5000));
+}
+
+void SyncHTTPClientTest::testCloseDelimited()
+{
+    HTTPStub stub;
+    stub.answer("HTTP/1.0 200 OK\r\n\r\nuntil the end", HTTPStub::Close);
+    stub.listen();
+
+    QByteArray data;
+    QVERIFY(SyncHTTPClient::get(stub.url(QStringLiteral("/")), data));
+    QCOMPARE(data, QByteArray("until the end"));
+
+    QVERIFY(stub.wait(5000));
+}
+
+void SyncHTTPClientTest::testRedirect()
+{
+    HTTPStub stub;
+    stub.answer("HTTP/1.1 302 Found\r\nLocation: /target\r\nContent-Length: 0\r\n\r\n");
+    stub.answer("HTTP/1.1 200 OK\r\nContent-Length: 6\r\n\r\ntarget");
+    stub.listen();
+
+    QByteArray data;
+    QVERIFY(SyncHTTPClient::get(stub.url(QStringLiteral("/source")), data));
+    QCOMPARE(data, QByteArray("target"));
+
+    QVERIFY(stub.wait(5000));
+    QCOMPARE(stub.requests().count(), 2);
+    QVERIFY(stub.requests().at(1).startsWith("GET /target HTTP/1.1\r\n"));
+}
+
+void SyncHTTPClientTest::testStatus()
+{
+    HTTPStub stub;
+    stub.answer("HTTP/1.1 404 Not Found\r\nContent-Length: 9\r\n\r\nnot found");
+    stub.listen();
+
+    QByteArray data;
+    int status;
+    QVERIFY(!SyncHTTPClient::get(stub.url(QStringLiteral("/")), data, &status));
+    QCOMPARE(status, 404);
+
+    QVERIFY(stub.wait(5000));
+}
+
+void SyncHTTPClientTest::testKeepAlive()
+{
+    HTTPStub stub;
+    stub.answer("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nfirst");
+    stub.answer("HTTP/1.1 200 OK\r\nContent-Length: 6\r\n\r\nsecond");
+    // The server gives up on the kept alive connection, the request is
+    // sent again on a new one
+    stub.answer(QByteArray(), HTTPStub::Drop);
+    stub.answer("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nthird");
+    stub.listen();
+
+    QByteArray data;
+    QVERIFY(SyncHTTPClient::get(stub.url(QStringLiteral("/1")), data));
+    QCOMPARE(data, QByteArray("first"));
+    QVERIFY(SyncHTTPClient::get(stub.url(QStringLiteral("/2")), data));
+    QCOMPARE(data, QByteArray("second"));
+    QCOMPARE(stub.connections(), 1);
+
+    QVERIFY(SyncHTTPClient::get(stub.url(QStringLiteral("/3")), data));
+    QCOMPARE(data, QByteArray("third"));
+    QCOMPARE(stub.connections(), 2);
+
+    QVERIFY(stub.wait(5000));
+    QCOMPARE(stub.requests().count(), 4);
+    QVERIFY(stub.requests().at(2).startsWith("GET /3 "));
+    QVERIFY(stub.requests().at(3).startsWith("GET /3 "));
+}
+
+void SyncHTTPClientTest::testTooLarge()
+{
+    HTTPStub stub;
+    const QByteArray body(17 * 1024 * 1024, 'x');
+    stub.answer("HTTP/1.1 200 OK\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\n\r\n" + body, HTTPStub::Close);
+    stub.listen();
+
+    QByteArray data;
+    QVERIFY(!SyncHTTPClient::get(stub.url(QStringLiteral("/")), data));
+    QVERIFY(data.isEmpty());
+
+    QVERIFY(stub.wait(10000));
+}
+
+QTEST_GUILESS_MAIN(SyncHTTPClientTest)
+
+#include "moc_synchttpclienttest.cpp"
@@ -0,0 +1,25 @@
+/*
+    SPDX-FileCopyrightText: 2026 libkcddb authors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef SYNCHTTPCLIENTTEST_H
+#define SYNCHTTPCLIENTTEST_H
+
+#include <QObject>
+
+class SyncHTTPClientTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testContentLength();
+    void testChunked();
+    void testCloseDelimited();
+    void testRedirect();
+    void testStatus();
+    void testKeepAlive();
+    void testTooLarge();
+};
+
+#endif